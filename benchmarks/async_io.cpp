@@ -0,0 +1,152 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+// compares reaver::async_io against blocking preads pushed onto a thread_pool
+// usage: async_io [file]; without a file, a temporary 64MiB file is created; reads are 4KiB at random offsets
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <reaver/async_io.h>
+#include <reaver/thread_pool.h>
+
+namespace
+{
+constexpr std::size_t block_size = 4096;
+constexpr std::size_t reads = 65536;
+
+template<typename T>
+void wait_all(std::vector<reaver::future<T>> & futures)
+{
+    for (auto & future : futures)
+    {
+        while (!future.try_get())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template<typename F>
+void measure(const char * name, F && f)
+{
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    std::cout << name << ": " << reads << " reads, " << us << "us, " << us * 1000 / reads << "ns per read\n";
+}
+}
+
+int main(int argc, char ** argv)
+{
+    std::string path;
+    bool temporary = argc < 2;
+
+    if (temporary)
+    {
+        path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+        std::ofstream file{ path, std::ios::binary };
+        std::string block(block_size, 'x');
+        for (std::size_t i = 0; i < 64 * 1024 * 1024 / block_size; ++i)
+        {
+            file << block;
+        }
+    }
+
+    else
+    {
+        path = argv[1];
+    }
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    ::fstat(fd, &info);
+    auto blocks = static_cast<std::uint64_t>(info.st_size) / block_size;
+
+    std::vector<std::uint64_t> offsets;
+    std::uint64_t state = 0x9e3779b97f4a7c15;
+    for (std::size_t i = 0; i < reads; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        offsets.push_back(state % blocks * block_size);
+    }
+
+    std::vector<char> buffer(reads * block_size);
+    auto pool = std::make_shared<reaver::thread_pool>(4);
+
+    measure("blocking pread on a thread_pool(4)", [&] {
+        std::vector<reaver::future<std::size_t>> futures;
+        for (std::size_t i = 0; i < reads; ++i)
+        {
+            auto pair = reaver::make_promise<std::size_t>();
+            pool->push([&, i, promise = pair.promise] { promise.set(static_cast<std::size_t>(::pread(fd, &buffer[i * block_size], block_size, offsets[i]))); });
+            futures.push_back(std::move(pair.future));
+        }
+        wait_all(futures);
+    });
+
+    reaver::async_io io{ pool };
+    std::cout << "(async_io is " << (io.uses_io_uring() ? "using io_uring" : "falling back to the pool") << ")\n";
+
+    measure("async_io::read_at", [&] {
+        std::vector<reaver::future<std::size_t>> futures;
+        for (std::size_t i = 0; i < reads; ++i)
+        {
+            futures.push_back(io.read_at(fd, &buffer[i * block_size], block_size, offsets[i]));
+        }
+        wait_all(futures);
+    });
+
+    measure("async_io, batches of 64", [&] {
+        std::vector<reaver::future<std::size_t>> futures;
+        for (std::size_t i = 0; i < reads; i += 64)
+        {
+            auto batch = io.make_batch();
+            for (std::size_t j = i; j < i + 64 && j < reads; ++j)
+            {
+                futures.push_back(batch.read_at(fd, &buffer[j * block_size], block_size, offsets[j]));
+            }
+        }
+        wait_all(futures);
+    });
+
+    ::close(fd);
+    if (temporary)
+    {
+        boost::filesystem::remove(path);
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+// compares reaver::wildcard::pattern_set against checking every pattern in turn with compiled_pattern
+// 1000 patterns are matched against 1000000 generated file names
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <reaver/wildcard.h>
+
+namespace
+{
+template<typename F>
+void measure(const char * name, std::size_t names, F && f)
+{
+    auto begin = std::chrono::steady_clock::now();
+    auto matches = f();
+    auto end = std::chrono::steady_clock::now();
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    std::cout << name << ": " << names << " names, " << matches << " matches, " << us << "us, " << us * 1000 / names << "ns per name\n";
+}
+}
+
+int main()
+{
+    constexpr std::size_t pattern_count = 1000;
+    constexpr std::size_t name_count = 1000000;
+
+    std::vector<std::string> patterns;
+    for (std::size_t i = 0; i < pattern_count; ++i)
+    {
+        auto n = std::to_string(i);
+        switch (i % 4)
+        {
+            case 0:
+                patterns.push_back("*.ext" + n);
+                break;
+            case 1:
+                patterns.push_back("module" + n + "_*");
+                break;
+            case 2:
+                patterns.push_back("*test" + n + "*.cpp");
+                break;
+            case 3:
+                patterns.push_back("src?" + n + "*/*.h");
+                break;
+        }
+    }
+
+    std::vector<std::string> names;
+    std::uint64_t state = 0x9e3779b97f4a7c15;
+    for (std::size_t i = 0; i < name_count; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        auto n = std::to_string(state % (pattern_count * 4));
+        switch (state % 5)
+        {
+            case 0:
+                names.push_back("file" + n + ".ext" + std::to_string(state % 3000));
+                break;
+            case 1:
+                names.push_back("module" + n + "_impl.cpp");
+                break;
+            case 2:
+                names.push_back("unit_test" + n + "_main.cpp");
+                break;
+            default:
+                names.push_back("some_ordinary_name_" + n + ".txt");
+                break;
+        }
+    }
+
+    reaver::wildcard::pattern_set set{ patterns };
+    measure("pattern_set", names.size(), [&] {
+        std::size_t matches = 0;
+        std::vector<std::size_t> result;
+        for (auto && name : names)
+        {
+            set.matches(name, result);
+            matches += result.size();
+        }
+        return matches;
+    });
+
+    // this one is far slower, so it only gets a slice of the names
+    std::vector<reaver::wildcard::compiled_pattern> compiled(patterns.begin(), patterns.end());
+    constexpr std::size_t slice = name_count / 100;
+    measure("compiled_pattern, one by one", slice, [&] {
+        std::size_t matches = 0;
+        for (std::size_t i = 0; i < slice; ++i)
+        {
+            for (auto && pattern : compiled)
+            {
+                matches += pattern.matches(names[i]);
+            }
+        }
+        return matches;
+    });
+}
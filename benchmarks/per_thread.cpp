@@ -0,0 +1,113 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+// compares per_thread against pthread_getspecific, the way tls_variable used to be implemented
+// every thread increments its own counter 100000000 times; only the owner writes a counter, so the increments don't need to be atomic
+// read-modify-writes, just atomic loads and stores that for_each can read concurrently
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <reaver/tls.h>
+
+namespace
+{
+constexpr std::size_t thread_count = 4;
+constexpr std::size_t iterations = 100000000;
+
+// the cpu time of every thread is measured separately, so that the result doesn't depend on how many cores there are to run them
+std::int64_t thread_time_ns()
+{
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000000000ll + time.tv_nsec;
+}
+
+template<typename F>
+void measure(const char * name, F && f)
+{
+    std::atomic<std::int64_t> total_ns{ 0 };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&] {
+            auto begin = thread_time_ns();
+            f();
+            total_ns += thread_time_ns() - begin;
+        });
+    }
+
+    for (auto && thread : threads)
+    {
+        thread.join();
+    }
+
+    auto ns = total_ns.load();
+    std::cout << name << ": " << thread_count << " threads, " << ns / 1000 << "us in total, " << static_cast<double>(ns) / (iterations * thread_count)
+              << "ns per increment\n";
+}
+}
+
+int main()
+{
+    std::atomic<std::uint64_t> exited{ 0 };
+    reaver::per_thread<std::atomic<std::uint64_t>> counters{ [] { return std::atomic<std::uint64_t>{ 0 }; },
+        [&](std::atomic<std::uint64_t> & counter) { exited += counter.load(); } };
+
+    measure("per_thread", [&] {
+        auto & counter = counters;
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    });
+
+    pthread_key_t key;
+    pthread_key_create(&key, nullptr);
+
+    measure("pthread_getspecific", [&] {
+        std::atomic<std::uint64_t> local{ 0 };
+        pthread_setspecific(key, &local);
+
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            auto counter = static_cast<std::atomic<std::uint64_t> *>(pthread_getspecific(key));
+            counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        exited += local.load();
+    });
+
+    pthread_key_delete(key);
+
+    std::uint64_t live = 0;
+    counters.for_each([&](const std::atomic<std::uint64_t> & counter) { live += counter.load(); });
+    std::cout << "total: " << exited.load() << ", still in per_thread: " << live << "\n";
+}
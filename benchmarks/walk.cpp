@@ -0,0 +1,106 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+// compares reaver::filesystem::walk() against boost::filesystem::recursive_directory_iterator, and wildcard() with and without a directory_cache
+// usage: walk [directory]; without a directory, a temporary tree of 100 directories with 1000 files each is created
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include <reaver/filesystem.h>
+
+namespace
+{
+template<typename F>
+void measure(const char * name, F && f)
+{
+    constexpr int runs = 5;
+
+    std::size_t entries = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i)
+    {
+        entries = f();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / runs;
+    std::cout << name << ": " << entries << " entries, " << us << "us per walk, " << (entries ? us * 1000 / entries : 0) << "ns per entry\n";
+}
+}
+
+int main(int argc, char ** argv)
+{
+    boost::filesystem::path root;
+    bool temporary = argc < 2;
+
+    if (temporary)
+    {
+        root = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        for (int i = 0; i < 100; ++i)
+        {
+            auto dir = root / std::to_string(i);
+            boost::filesystem::create_directories(dir);
+            for (int j = 0; j < 1000; ++j)
+            {
+                std::ofstream{ (dir / (std::to_string(j) + ".cpp")).string() };
+            }
+        }
+    }
+
+    else
+    {
+        root = argv[1];
+    }
+
+    measure("boost recursive_directory_iterator", [&] {
+        std::size_t count = 0;
+        for (auto it = boost::filesystem::recursive_directory_iterator{ root }; it != boost::filesystem::recursive_directory_iterator{}; ++it)
+        {
+            ++count;
+        }
+        return count;
+    });
+
+    measure("reaver::filesystem::walk", [&] {
+        std::size_t count = 0;
+        reaver::filesystem::walk(root, [&](std::string_view, reaver::filesystem::entry_type) {
+            ++count;
+            return true;
+        });
+        return count;
+    });
+
+    measure("reaver::filesystem::wildcard(\"**/*.cpp\")", [&] { return reaver::filesystem::wildcard("**/*.cpp", root).size(); });
+
+    reaver::filesystem::directory_cache cache;
+    reaver::filesystem::wildcard("**/*.cpp", root, cache);
+    measure("reaver::filesystem::wildcard(\"**/*.cpp\"), cached", [&] { return reaver::filesystem::wildcard("**/*.cpp", root, cache).size(); });
+
+    if (temporary)
+    {
+        boost::filesystem::remove_all(root);
+    }
+}
@@ -0,0 +1,713 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "exception.h"
+#include "executor.h"
+#include "function.h"
+#include "future.h"
+
+namespace reaver
+{
+inline namespace _v1
+{
+    class async_io_error : public exception
+    {
+    public:
+        async_io_error(const char * operation, int error) : exception{ logger::error }, _error{ error }
+        {
+            *this << operation << " failed: " << std::strerror(error) << ".";
+        }
+
+        int error_code() const
+        {
+            return _error;
+        }
+
+    private:
+        int _error;
+    };
+
+    namespace _detail
+    {
+        // a minimal io_uring, talked to with raw system calls, so that there is no dependency on liburing
+        // submissions must be serialized by the caller; completions are meant to be reaped by a single thread
+        class _io_uring
+        {
+        public:
+            _io_uring() = default;
+            _io_uring(const _io_uring &) = delete;
+            _io_uring & operator=(const _io_uring &) = delete;
+
+            ~_io_uring()
+            {
+                if (_fd >= 0)
+                {
+                    _unmap();
+                    ::close(_fd);
+                }
+            }
+
+            // returns false if io_uring isn't available, for instance because the kernel is too old, or a seccomp filter refuses it
+            bool setup(unsigned entries)
+            {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+
+                _fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                if (_fd < 0)
+                {
+                    return false;
+                }
+
+                _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+                bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if (single_mmap)
+                {
+                    _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+                }
+
+                _sq_ring = _map(_sq_ring_size, IORING_OFF_SQ_RING);
+                _cq_ring = single_mmap ? _sq_ring : _map(_cq_ring_size, IORING_OFF_CQ_RING);
+                _sqes = static_cast<io_uring_sqe *>(_map(_sqes_size, IORING_OFF_SQES));
+
+                // reads and writes without iovecs, and the guarantee not to drop completions, came with 5.6; older kernels use the fallback
+                auto required = IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+                if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || _sqes == MAP_FAILED || (params.features & required) != required)
+                {
+                    _unmap();
+                    ::close(_fd);
+                    _fd = -1;
+                    return false;
+                }
+
+                auto sq = static_cast<char *>(_sq_ring);
+                _sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+                _sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                _sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                _sq_entries = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+                _sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+                auto cq = static_cast<char *>(_cq_ring);
+                _cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                _cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                _cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+                return true;
+            }
+
+            // returns a cleared submission queue entry, which is queued once it's filled in and the next one is requested,
+            // or submit() is called; when the queue is full, everything queued so far is submitted first
+            io_uring_sqe & next_sqe()
+            {
+                while (_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries)
+                {
+                    submit();
+                }
+
+                auto index = _local_tail & _sq_mask;
+                auto & sqe = _sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+
+                _sq_array[index] = index;
+                ++_local_tail;
+
+                return sqe;
+            }
+
+            // hands everything queued by next_sqe() over to the kernel, with a single system call
+            // if that fails, the entries the kernel didn't take are taken back out of the queue, and async_io_error is thrown;
+            // submitted() tells how many were taken
+            void submit()
+            {
+                __atomic_store_n(_sq_tail, _local_tail, __ATOMIC_RELEASE);
+
+                auto pending = _local_tail - _submitted;
+                while (pending)
+                {
+                    auto result = ::syscall(__NR_io_uring_enter, _fd, pending, 0, 0, nullptr, 0);
+                    if (result < 0)
+                    {
+                        if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                        {
+                            continue;
+                        }
+
+                        auto error = errno;
+                        withdraw();
+                        throw async_io_error{ "io_uring_enter", error };
+                    }
+
+                    pending -= static_cast<unsigned>(result);
+                    _submitted += static_cast<unsigned>(result);
+                }
+            }
+
+            // takes the entries that weren't submitted yet back out of the queue
+            // without SQPOLL, the kernel only takes entries inside io_uring_enter, so they can't be in use
+            void withdraw()
+            {
+                _local_tail = _submitted;
+                __atomic_store_n(_sq_tail, _local_tail, __ATOMIC_RELEASE);
+            }
+
+            // the number of entries taken by the kernel so far; wraps around
+            unsigned submitted() const
+            {
+                return _submitted;
+            }
+
+            // blocks until there is at least one completion, then calls f(user_data, result) for all of them
+            template<typename F>
+            void reap(F && f)
+            {
+                auto head = *_cq_head;
+                while (head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE))
+                {
+                    auto result = ::syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if (result < 0 && errno != EINTR)
+                    {
+                        throw async_io_error{ "io_uring_enter", errno };
+                    }
+                }
+
+                auto tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head)
+                {
+                    const auto & cqe = _cqes[head & _cq_mask];
+                    f(cqe.user_data, cqe.res);
+                }
+
+                __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+            }
+
+        private:
+            void _unmap()
+            {
+                if (_sqes != MAP_FAILED)
+                {
+                    ::munmap(_sqes, _sqes_size);
+                }
+
+                if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring)
+                {
+                    ::munmap(_cq_ring, _cq_ring_size);
+                }
+
+                if (_sq_ring != MAP_FAILED)
+                {
+                    ::munmap(_sq_ring, _sq_ring_size);
+                }
+            }
+
+            void * _map(std::size_t size, std::uint64_t offset)
+            {
+                return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, static_cast<off_t>(offset));
+            }
+
+            int _fd = -1;
+
+            void * _sq_ring = MAP_FAILED;
+            void * _cq_ring = MAP_FAILED;
+            io_uring_sqe * _sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+            std::size_t _sq_ring_size = 0;
+            std::size_t _cq_ring_size = 0;
+            std::size_t _sqes_size = 0;
+
+            unsigned * _sq_head = nullptr;
+            unsigned * _sq_tail = nullptr;
+            unsigned * _sq_array = nullptr;
+            unsigned _sq_mask = 0;
+            unsigned _sq_entries = 0;
+            unsigned _local_tail = 0;
+            unsigned _submitted = 0;
+
+            unsigned * _cq_head = nullptr;
+            unsigned * _cq_tail = nullptr;
+            unsigned _cq_mask = 0;
+            io_uring_cqe * _cqes = nullptr;
+        };
+
+        struct _io_operation
+        {
+            enum
+            {
+                read,
+                write,
+                fsync
+            } kind;
+
+            int fd;
+            void * buffer;
+            std::size_t size;
+            std::uint64_t offset;
+            bool data_only;
+
+            // called with the result of the operation, as returned by io_uring: a byte count, or a negated errno value
+            unique_function<void(long)> complete;
+        };
+
+        // an operation handed over to io_uring; the pointer to it is the entry's user_data
+        struct _pending_operation
+        {
+            unique_function<void(long)> complete;
+
+            _pending_operation * previous = nullptr;
+            _pending_operation * next = nullptr;
+        };
+
+        inline unique_function<void(long)> _complete_with(manual_promise<std::size_t> promise, const char * operation)
+        {
+            return [promise = std::move(promise), operation](long result) {
+                if (result < 0)
+                {
+                    promise.set(std::make_exception_ptr(async_io_error{ operation, static_cast<int>(-result) }));
+                    return;
+                }
+
+                promise.set(static_cast<std::size_t>(result));
+            };
+        }
+
+        inline unique_function<void(long)> _complete_with(manual_promise<void> promise, const char * operation)
+        {
+            return [promise = std::move(promise), operation](long result) {
+                if (result < 0)
+                {
+                    promise.set(std::make_exception_ptr(async_io_error{ operation, static_cast<int>(-result) }));
+                    return;
+                }
+
+                promise.set();
+            };
+        }
+
+        // the same operation as a blocking system call, with the result in the same form as io_uring's
+        inline long _perform(const _io_operation & op)
+        {
+            while (true)
+            {
+                long result = 0;
+                switch (op.kind)
+                {
+                    case _io_operation::read:
+                        result = ::pread(op.fd, op.buffer, op.size, static_cast<off_t>(op.offset));
+                        break;
+                    case _io_operation::write:
+                        result = ::pwrite(op.fd, op.buffer, op.size, static_cast<off_t>(op.offset));
+                        break;
+                    case _io_operation::fsync:
+                        result = op.data_only ? ::fdatasync(op.fd) : ::fsync(op.fd);
+                        break;
+                }
+
+                if (result >= 0)
+                {
+                    return result;
+                }
+
+                if (errno != EINTR)
+                {
+                    return -errno;
+                }
+            }
+        }
+    }
+
+    // asynchronous reads, writes and syncs of file descriptors, through io_uring
+    // every completion is handled by a single reaper thread, which fulfills the futures; continuations attached to them
+    // should be scheduled on an executor, so that they don't hold up other completions
+    // when io_uring isn't available, or the queue depth is 0, every operation is run as a blocking system call on the fallback executor instead
+    // like pread and pwrite, reads and writes can complete with fewer bytes than requested
+    // buffers have to stay alive and untouched until the operation that uses them completes
+    // if the ring stops working, the operations in flight fail with async_io_error, and later ones go to the fallback executor;
+    // the buffers of the failed operations can still be touched by the kernel until the async_io object is destroyed
+    class async_io
+    {
+    public:
+        class batch;
+
+        async_io(std::shared_ptr<executor> fallback, unsigned queue_depth = 256) : _fallback{ std::move(fallback) }
+        {
+            if (!queue_depth || !_ring.setup(queue_depth))
+            {
+                return;
+            }
+
+            // the reaper is stopped by a poll of an eventfd, armed up front, so that stopping it doesn't need to submit anything
+            _wake = ::eventfd(0, EFD_CLOEXEC);
+            if (_wake < 0)
+            {
+                return;
+            }
+
+            try
+            {
+                auto & sqe = _ring.next_sqe();
+                sqe.opcode = IORING_OP_POLL_ADD;
+                sqe.fd = _wake;
+                sqe.poll_events = POLLIN;
+                sqe.user_data = 0;
+                _ring.submit();
+            }
+
+            catch (async_io_error &)
+            {
+                return;
+            }
+
+            _reaper = std::thread{ [this] { _reap(); } };
+        }
+
+        async_io(const async_io &) = delete;
+        async_io & operator=(const async_io &) = delete;
+
+        // waits for all of the operations that were submitted to complete
+        ~async_io()
+        {
+            if (_reaper.joinable())
+            {
+                // if the ring broke, the reaper has already returned, and this is never read
+                ::eventfd_write(_wake, 1);
+                _reaper.join();
+            }
+
+            if (_wake >= 0)
+            {
+                ::close(_wake);
+            }
+        }
+
+        bool uses_io_uring() const
+        {
+            return _reaper.joinable() && !_broken;
+        }
+
+        future<std::size_t> read_at(int fd, void * buffer, std::size_t size, std::uint64_t offset);
+        future<std::size_t> write_at(int fd, const void * buffer, std::size_t size, std::uint64_t offset);
+        future<void> fsync(int fd, bool data_only = false);
+
+        // operations added to a batch are submitted together, with a single system call, when submit() is called
+        // or the batch is destroyed
+        batch make_batch();
+
+    private:
+        void _submit(std::vector<_detail::_io_operation> & operations)
+        {
+            std::vector<std::unique_ptr<_detail::_pending_operation>> failed;
+            std::size_t queued = 0;
+            int error = 0;
+
+            {
+                std::unique_lock<std::mutex> lock{ _submit_lock };
+
+                if (!_reaper.joinable() || _broken)
+                {
+                    lock.unlock();
+
+                    for (auto & op : operations)
+                    {
+                        _fallback->push([op = std::move(op)]() mutable { op.complete(_detail::_perform(op)); });
+                    }
+
+                    operations.clear();
+                    return;
+                }
+
+                auto submitted = _ring.submitted();
+                std::vector<_detail::_pending_operation *> pending;
+
+                try
+                {
+                    pending.reserve(operations.size());
+
+                    for (auto & op : operations)
+                    {
+                        // allocated before the entry is taken, so that no entry is ever queued without its user_data
+                        pending.push_back(new _detail::_pending_operation{ std::move(op.complete) });
+                        _link(pending.back());
+                        ++queued;
+
+                        auto & sqe = _ring.next_sqe();
+                        sqe.fd = op.fd;
+                        sqe.user_data = reinterpret_cast<std::uintptr_t>(pending.back());
+
+                        switch (op.kind)
+                        {
+                            case _detail::_io_operation::read:
+                            case _detail::_io_operation::write:
+                                sqe.opcode = op.kind == _detail::_io_operation::read ? IORING_OP_READ : IORING_OP_WRITE;
+                                sqe.addr = reinterpret_cast<std::uintptr_t>(op.buffer);
+                                // io_uring takes a 32 bit length; like pread and pwrite, larger requests complete short
+                                sqe.len = static_cast<unsigned>(std::min<std::size_t>(op.size, INT_MAX));
+                                sqe.off = op.offset;
+                                break;
+
+                            case _detail::_io_operation::fsync:
+                                sqe.opcode = IORING_OP_FSYNC;
+                                sqe.fsync_flags = op.data_only ? IORING_FSYNC_DATASYNC : 0;
+                                break;
+                        }
+                    }
+
+                    _ring.submit();
+                }
+
+                catch (async_io_error & e)
+                {
+                    error = e.error_code();
+                }
+
+                catch (std::bad_alloc &)
+                {
+                    error = ENOMEM;
+                }
+
+                if (error)
+                {
+                    // whatever the kernel didn't take won't ever complete, so it's failed here; so are the operations
+                    // that didn't make it into the queue
+                    _ring.withdraw();
+
+                    for (auto i = static_cast<std::size_t>(_ring.submitted() - submitted); i < queued; ++i)
+                    {
+                        _unlink(pending[i]);
+                        failed.emplace_back(pending[i]);
+                    }
+                }
+            }
+
+            // outside of the lock, since continuations can submit more operations
+            for (auto & op : failed)
+            {
+                op->complete(-error);
+            }
+
+            for (auto i = queued; error && i < operations.size(); ++i)
+            {
+                operations[i].complete(-error);
+            }
+
+            operations.clear();
+        }
+
+        void _reap()
+        {
+            bool stopping = false;
+
+            try
+            {
+                while (!stopping || !_empty())
+                {
+                    _ring.reap([&](std::uint64_t user_data, long result) {
+                        if (!user_data)
+                        {
+                            stopping = true;
+                            return;
+                        }
+
+                        std::unique_ptr<_detail::_pending_operation> pending{ reinterpret_cast<_detail::_pending_operation *>(user_data) };
+                        _unlink(pending.get());
+                        pending->complete(result);
+                    });
+                }
+            }
+
+            catch (async_io_error & e)
+            {
+                // completions can't be waited for anymore; new operations go to the fallback executor, and the ones in flight fail
+                // their buffers may still be used by the kernel until this object is destroyed, which tears the ring down
+                {
+                    std::lock_guard<std::mutex> lock{ _submit_lock };
+                    _broken = true;
+                }
+
+                std::vector<std::unique_ptr<_detail::_pending_operation>> failed;
+
+                {
+                    std::lock_guard<std::mutex> lock{ _pending_lock };
+                    while (auto pending = _pending)
+                    {
+                        _pending = pending->next;
+                        failed.emplace_back(pending);
+                    }
+                }
+
+                for (auto & pending : failed)
+                {
+                    pending->complete(-e.error_code());
+                }
+            }
+        }
+
+        // every operation in flight is kept on a list, so that they can be failed if the ring stops working
+        void _link(_detail::_pending_operation * pending)
+        {
+            std::lock_guard<std::mutex> lock{ _pending_lock };
+            pending->next = _pending;
+            if (_pending)
+            {
+                _pending->previous = pending;
+            }
+            _pending = pending;
+        }
+
+        void _unlink(_detail::_pending_operation * pending)
+        {
+            std::lock_guard<std::mutex> lock{ _pending_lock };
+            (pending->previous ? pending->previous->next : _pending) = pending->next;
+            if (pending->next)
+            {
+                pending->next->previous = pending->previous;
+            }
+        }
+
+        bool _empty()
+        {
+            std::lock_guard<std::mutex> lock{ _pending_lock };
+            return !_pending;
+        }
+
+        std::shared_ptr<executor> _fallback;
+
+        std::mutex _submit_lock;
+        _detail::_io_uring _ring;
+        std::atomic<bool> _broken{ false };
+
+        std::mutex _pending_lock;
+        _detail::_pending_operation * _pending = nullptr;
+
+        int _wake = -1;
+
+        // must stay the last member; the reaper uses all of the above
+        std::thread _reaper;
+    };
+
+    class async_io::batch
+    {
+    public:
+        batch(const batch &) = delete;
+        batch & operator=(const batch &) = delete;
+        batch(batch &&) = default;
+
+        ~batch()
+        {
+            submit();
+        }
+
+        future<std::size_t> read_at(int fd, void * buffer, std::size_t size, std::uint64_t offset)
+        {
+            auto pair = make_promise<std::size_t>();
+            _operations.push_back(
+                { _detail::_io_operation::read, fd, buffer, size, offset, false, _detail::_complete_with(std::move(pair.promise), "read") });
+            return std::move(pair.future);
+        }
+
+        future<std::size_t> write_at(int fd, const void * buffer, std::size_t size, std::uint64_t offset)
+        {
+            auto pair = make_promise<std::size_t>();
+            _operations.push_back({ _detail::_io_operation::write,
+                fd,
+                const_cast<void *>(buffer),
+                size,
+                offset,
+                false,
+                _detail::_complete_with(std::move(pair.promise), "write") });
+            return std::move(pair.future);
+        }
+
+        future<void> fsync(int fd, bool data_only = false)
+        {
+            auto pair = make_promise<void>();
+            _operations.push_back({ _detail::_io_operation::fsync, fd, nullptr, 0, 0, data_only, _detail::_complete_with(std::move(pair.promise), "fsync") });
+            return std::move(pair.future);
+        }
+
+        void submit()
+        {
+            if (!_operations.empty())
+            {
+                _io->_submit(_operations);
+            }
+        }
+
+    private:
+        friend class async_io;
+
+        batch(async_io & io) : _io{ &io }
+        {
+        }
+
+        async_io * _io;
+        std::vector<_detail::_io_operation> _operations;
+    };
+
+    inline async_io::batch async_io::make_batch()
+    {
+        return batch{ *this };
+    }
+
+    inline future<std::size_t> async_io::read_at(int fd, void * buffer, std::size_t size, std::uint64_t offset)
+    {
+        auto b = make_batch();
+        return b.read_at(fd, buffer, size, offset);
+    }
+
+    inline future<std::size_t> async_io::write_at(int fd, const void * buffer, std::size_t size, std::uint64_t offset)
+    {
+        auto b = make_batch();
+        return b.write_at(fd, buffer, size, offset);
+    }
+
+    inline future<void> async_io::fsync(int fd, bool data_only)
+    {
+        auto b = make_batch();
+        return b.fsync(fd, data_only);
+    }
+}
+}
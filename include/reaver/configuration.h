@@ -22,3 +22,5 @@
 
 #include "configuration/configuration.h"
 #include "configuration/default.h"
+#include "configuration/shared_configuration.h"
+#include "configuration/static_configuration.h"
@@ -0,0 +1,229 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "../exception.h"
+#include "../id.h"
+#include "../tpl/vector.h"
+#include "schema.h"
+#include "static_configuration.h"
+
+namespace reaver
+{
+namespace options
+{
+    inline namespace _v1
+    {
+        class unknown_option : public exception
+        {
+        public:
+            unknown_option(std::string_view argument) : exception{ logger::error }
+            {
+                *this << "unknown option `" << std::string{ argument } << "`.";
+            }
+        };
+
+        class missing_option : public exception
+        {
+        public:
+            missing_option(const char * name) : exception{ logger::error }
+            {
+                *this << "required option `" << name << "` not specified.";
+            }
+        };
+
+        class missing_option_value : public exception
+        {
+        public:
+            missing_option_value(std::string_view argument) : exception{ logger::error }
+            {
+                *this << "option `" << std::string{ argument } << "` requires a value.";
+            }
+        };
+
+        class invalid_option_value : public exception
+        {
+        public:
+            invalid_option_value(std::string_view argument, std::string_view value) : exception{ logger::error }
+            {
+                *this << "invalid value `" << std::string{ value } << "` for option `" << std::string{ argument } << "`.";
+            }
+        };
+
+        class unexpected_argument : public exception
+        {
+        public:
+            unexpected_argument(std::string_view argument) : exception{ logger::error }
+            {
+                *this << "unexpected argument `" << std::string{ argument } << "`.";
+            }
+        };
+
+        namespace _detail
+        {
+            // calls store(index, argument, value) for every value on the command line, in order
+            template<typename Schema, typename Store>
+            void _parse_argv(int argc, const char * const * argv, Store && store)
+            {
+                auto next_value = [&](int & i, std::string_view argument) -> std::string_view {
+                    if (i + 1 >= argc)
+                    {
+                        throw missing_option_value{ argument };
+                    }
+
+                    return argv[++i];
+                };
+
+                std::size_t position = 0;
+                std::size_t position_used = 0;
+                bool only_positional = false;
+
+                for (int i = 1; i < argc; ++i)
+                {
+                    std::string_view argument = argv[i];
+
+                    if (!only_positional && argument == "--")
+                    {
+                        only_positional = true;
+                        continue;
+                    }
+
+                    if (only_positional || argument.size() < 2 || argument.front() != '-')
+                    {
+                        if (position == Schema::positional_count)
+                        {
+                            throw unexpected_argument{ argument };
+                        }
+
+                        store(Schema::positional[position], argument, argument);
+                        if (++position_used == Schema::position_counts[Schema::positional[position]])
+                        {
+                            ++position;
+                            position_used = 0;
+                        }
+
+                        continue;
+                    }
+
+                    bool is_long = argument[1] == '-';
+                    auto body = argument.substr(is_long ? 2 : 1);
+                    auto equals = body.find('=');
+                    auto index = Schema::long_table.find(body.substr(0, equals));
+
+                    if (index != Schema::npos)
+                    {
+                        if (equals != std::string_view::npos)
+                        {
+                            store(index, argument, body.substr(equals + 1));
+                        }
+
+                        else
+                        {
+                            store(index, argument, Schema::is_flag[index] ? "true" : next_value(i, argument));
+                        }
+
+                        continue;
+                    }
+
+                    if (is_long)
+                    {
+                        throw unknown_option{ argument };
+                    }
+
+                    // a group of short options; the first one that takes a value consumes the rest of the argument, or the next one
+                    for (std::size_t j = 1; j < argument.size(); ++j)
+                    {
+                        auto short_index = Schema::short_table[static_cast<unsigned char>(argument[j])];
+                        if (short_index == Schema::npos)
+                        {
+                            throw unknown_option{ argument };
+                        }
+
+                        if (Schema::is_flag[short_index])
+                        {
+                            store(short_index, argument, "true");
+                            continue;
+                        }
+
+                        auto rest = argument.substr(j + 1);
+                        store(short_index, argument, !rest.empty() ? rest : next_value(i, argument));
+                        break;
+                    }
+                }
+            }
+
+            template<typename Schema, std::size_t N>
+            void _check_required(const std::array<bool, N> & seen)
+            {
+                for (std::size_t i = 0; i < N; ++i)
+                {
+                    if (Schema::is_required[i] && !seen[i])
+                    {
+                        throw missing_option{ Schema::display_name(i) };
+                    }
+                }
+            }
+        }
+
+        // parses the command line into a static_configuration of the given options, without boost.program_options
+        // option names are resolved with a perfect hash built at compile time, and values are parsed straight into the result;
+        // nothing is allocated other than the values themselves
+        // accepted forms: --long value, --long=value, -long (if it isn't a group of short options), -s value, -svalue and -abc
+        // for short flags; everything after `--` is positional
+        template<typename... Args>
+        auto static_parse_argv(int argc, const char * const * argv, id<Args>...)
+        {
+            using config_type = static_configuration<Args...>;
+            using schema = _detail::_option_schema<config_type, Args...>;
+
+            config_type config;
+            std::array<bool, sizeof...(Args)> seen{};
+
+            _detail::_parse_argv<schema>(argc, argv, [&](std::size_t index, std::string_view argument, std::string_view value) {
+                if (!schema::parsers[index](value, config, !seen[index]))
+                {
+                    throw invalid_option_value{ argument, value };
+                }
+
+                seen[index] = true;
+            });
+
+            _detail::_check_required<schema>(seen);
+
+            return config;
+        }
+
+        template<typename... Args>
+        auto static_parse_argv(int argc, const char * const * argv, tpl::vector<Args...>)
+        {
+            return static_parse_argv(argc, argv, id<Args>{}...);
+        }
+    }
+}
+}
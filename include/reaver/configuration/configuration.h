@@ -1,7 +1,7 @@
 /**
  * Reaver Library Licence
  *
- * Copyright © 2014-2017 Michał "Griwes" Dominiak
+ * Copyright © 2014-2017, 2026 Michał "Griwes" Dominiak
  *
  * This software is provided 'as-is', without any express or implied
  * warranty. In no event will the authors be held liable for any damages
@@ -24,6 +24,8 @@
 
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <boost/any.hpp>
 #include <boost/functional/hash.hpp>
@@ -140,127 +142,190 @@ inline namespace _v1
         struct _apply_on_type_list<Trait, T, std::tuple<Types...>> : Trait<T, Types...>
         {
         };
-    }
 
-    class configuration
-    {
-    public:
-        template<typename T, typename... Args>
-        unit set(Args &&... args)
+        // while a shared_configuration is being updated, the tags set by the updating thread are recorded here,
+        // together with the configuration they were set in; see shared_configuration::on_change
+        using _change_journal_type = std::vector<std::pair<const void *, boost::typeindex::type_index>>;
+
+        inline _change_journal_type *& _change_journal()
         {
-            _set<T, std::tuple<Args...>>(select_overload{})(std::forward<Args>(args)...);
-            return {};
+            thread_local _change_journal_type * journal = nullptr;
+            return journal;
         }
 
-        template<typename T, typename... Args>
-        unit set(T, Args &&... args)
+        template<typename T>
+        void _record_change(const void * config)
         {
-            set<T>(std::forward<Args>(args)...);
-            return {};
+            if (auto journal = _change_journal())
+            {
+                journal->emplace_back(config, boost::typeindex::type_id<T>());
+            }
         }
 
+        template<typename Tag, typename = void>
+        struct _has_default_value : public std::false_type
+        {
+        };
+
         template<typename T>
-        auto & get(T = {})
+        struct _has_default_value<T, std::void_t<decltype(T::default_value)>> : public std::true_type
         {
-            return _get<T>(select_overload{})();
-        }
+        };
+
+        template<typename Tag, typename = void>
+        struct _has_default_factory : public std::false_type
+        {
+        };
 
         template<typename T>
-        auto & get(T = {}) const
+        struct _has_default_factory<T, std::void_t<decltype(T::default_value())>> : public std::true_type
         {
-            return boost::any_cast<const typename T::type &>(_map.at(boost::typeindex::type_id<T>()));
+        };
+
+        // the default value of a tag; one of:
+        // 0 - `static constexpr type default_value`, used directly,
+        // 1 - `static type default_value()`, called once, on first use,
+        // 2 - `static constexpr U default_value`, converted to type once, on first use.
+        // the ones that need to be constructed are function-local statics, so they are built exactly once even when
+        // the first reads happen concurrently
+
+        template<typename T,
+            typename std::enable_if<std::is_same<std::remove_cv_t<decltype(T::default_value)>, typename T::type>::value, int>::type = 0>
+        const typename T::type & _default_value(choice<0>)
+        {
+            return T::default_value;
         }
 
-    private:
-        template<typename T, typename std::enable_if<std::is_void<decltype(T::default_value, void())>::value, int>::type = 0>
-        auto _get(choice<0>)
+        template<typename T, typename std::enable_if<_has_default_factory<T>::value, int>::type = 0>
+        const typename T::type & _default_value(choice<1>)
+        {
+            static const typename T::type value = T::default_value();
+            return value;
+        }
+
+        template<typename T>
+        const typename T::type & _default_value(choice<2>)
         {
-            return [&]() -> decltype(auto) {
-                if (_map.find(boost::typeindex::type_id<T>()) == _map.end())
-                {
-                    set<T>(typename T::type{ T::default_value });
-                }
-                return boost::any_cast<typename T::type &>(_map.at(boost::typeindex::type_id<T>()));
-            };
+            static const typename T::type value{ T::default_value };
+            return value;
         }
 
         template<typename T>
-        auto _get(choice<1>)
+        const typename T::type & _default_value()
         {
-            return [&]() -> decltype(auto) { return boost::any_cast<typename T::type &>(_map.at(boost::typeindex::type_id<T>())); };
+            return _default_value<T>(select_overload{});
         }
 
+        // selects the way of constructing the value of tag T out of arguments of types in TypeList
+        // the returned function object takes the arguments and returns a typename T::type
         // necessary forms:
-        // 0 - _map[boost::typeindex::type_id<T>()] =
-        // T::construct(std::move(value)), when identity
-        // construct exists
-        // 1 - _map[boost::typeindex::type_id<T>()] = std::move(value), when the
-        // target type is
-        // passed and no identity construct exists
-        // 2 - _map[boost::typeindex::type_id<T>()] =
-        // T::construct(std::forward<Arg>(arg)), with
-        // perfect match of argument type (modulo cref-qualifiers)
-        // 4 - _map[boost::typeindex::type_id<T>()] = static_cast<typename
-        // T::type>(std::forward<Arg>(arg)), if no perfectly matching construct
-        // 5 - _map[boost::typeindex::type_id<T>()] =
-        // T::construct(std::forward<Args>(args)...), if
-        // matching construct exists
-        // 6 - _map[boost::typeindex::type_id<T>()] = typename T::type{
-        // std::forward<Args>(args)...
-        // }, if possible
+        // 0 - T::construct(std::move(value)), when identity construct exists
+        // 1 - std::move(value), when the target type is passed and no identity construct exists
+        // 2 - T::construct(std::forward<Arg>(arg)), with perfect match of argument type (modulo cref-qualifiers)
+        // 3 - static_cast<typename T::type>(std::forward<Arg>(arg)), if no perfectly matching construct
+        // 4 - T::construct(std::forward<Args>(args)...), if matching construct exists
+        // 5 - typename T::type{ std::forward<Args>(args)... }, if possible
 
         template<typename T,
             typename TypeList,
-            typename std::enable_if<_detail::_apply_on_type_list<_detail::_is_same, typename T::type, TypeList>::value
-                    && _detail::_has_identity_construct<T>::value,
-                int>::type = 0>
-        auto _set(choice<0>)
+            typename std::enable_if<_apply_on_type_list<_is_same, typename T::type, TypeList>::value && _has_identity_construct<T>::value, int>::type = 0>
+        auto _make_value(choice<0>)
         {
-            return [&](typename T::type value) { _map[boost::typeindex::type_id<T>()] = static_cast<typename T::type>(T::construct(std::move(value))); };
+            return [](typename T::type value) { return static_cast<typename T::type>(T::construct(std::move(value))); };
         }
 
-        template<typename T,
-            typename TypeList,
-            typename std::enable_if<_detail::_apply_on_type_list<_detail::_is_same, typename T::type, TypeList>::value, int>::type = 0>
-        auto _set(choice<1>)
+        template<typename T, typename TypeList, typename std::enable_if<_apply_on_type_list<_is_same, typename T::type, TypeList>::value, int>::type = 0>
+        auto _make_value(choice<1>)
         {
-            return [&](typename T::type value) { _map[boost::typeindex::type_id<T>()] = std::move(value); };
+            return [](typename T::type value) { return value; };
         }
 
-        template<typename T,
-            typename TypeList,
-            typename std::enable_if<_detail::_apply_on_type_list<_detail::_has_exact_match, T, TypeList>::value, int>::type = 0>
-        auto _set(choice<2>)
+        template<typename T, typename TypeList, typename std::enable_if<_apply_on_type_list<_has_exact_match, T, TypeList>::value, int>::type = 0>
+        auto _make_value(choice<2>)
         {
-            return [&](auto &&... arg) {
-                _map[boost::typeindex::type_id<T>()] = static_cast<typename T::type>(T::construct(std::forward<decltype(arg)>(arg)...));
-            };
+            return [](auto &&... arg) { return static_cast<typename T::type>(T::construct(std::forward<decltype(arg)>(arg)...)); };
         }
 
-        template<typename T,
-            typename TypeList,
-            typename std::enable_if<_detail::_apply_on_type_list<_detail::_has_static_cast, T, TypeList>::value, int>::type = 0>
-        auto _set(choice<3>)
+        template<typename T, typename TypeList, typename std::enable_if<_apply_on_type_list<_has_static_cast, T, TypeList>::value, int>::type = 0>
+        auto _make_value(choice<3>)
         {
-            return [&](auto && arg) { _map[boost::typeindex::type_id<T>()] = static_cast<typename T::type>(std::forward<decltype(arg)>(arg)); };
+            return [](auto && arg) { return static_cast<typename T::type>(std::forward<decltype(arg)>(arg)); };
         }
 
-        template<typename T,
-            typename TypeList,
-            typename std::enable_if<_detail::_apply_on_type_list<_detail::_is_construct_callable, T, TypeList>::value, int>::type = 0>
-        auto _set(choice<4>)
+        template<typename T, typename TypeList, typename std::enable_if<_apply_on_type_list<_is_construct_callable, T, TypeList>::value, int>::type = 0>
+        auto _make_value(choice<4>)
         {
-            return [&](auto &&... args) {
-                _map[boost::typeindex::type_id<T>()] = static_cast<typename T::type>(T::construct(std::forward<decltype(args)>(args)...));
-            };
+            return [](auto &&... args) { return static_cast<typename T::type>(T::construct(std::forward<decltype(args)>(args)...)); };
         }
 
-        template<typename T,
-            typename TypeList,
-            typename std::enable_if<_detail::_apply_on_type_list<_detail::_is_constructible, T, TypeList>::value, int>::type = 0>
-        auto _set(choice<5>)
+        template<typename T, typename TypeList, typename std::enable_if<_apply_on_type_list<_is_constructible, T, TypeList>::value, int>::type = 0>
+        auto _make_value(choice<5>)
+        {
+            return [](auto &&... args) { return typename T::type{ std::forward<decltype(args)>(args)... }; };
+        }
+    }
+
+    class configuration
+    {
+    public:
+        template<typename T, typename... Args>
+        unit set(Args &&... args)
+        {
+            _map[boost::typeindex::type_id<T>()] = _detail::_make_value<T, std::tuple<Args...>>(select_overload{})(std::forward<Args>(args)...);
+            _detail::_record_change<T>(this);
+            return {};
+        }
+
+        template<typename T, typename... Args>
+        unit set(T, Args &&... args)
+        {
+            set<T>(std::forward<Args>(args)...);
+            return {};
+        }
+
+        template<typename T>
+        auto & get(T = {})
+        {
+            return _get<T>(select_overload{});
+        }
+
+        template<typename T>
+        auto & get(T = {}) const
+        {
+            return _get<T>(select_overload{});
+        }
+
+    private:
+        // tags with a default value are read-only through get(), so that reading a value that was never set doesn't need to
+        // insert the default into the map
+        template<typename T, typename std::enable_if<_detail::_has_default_value<T>::value, int>::type = 0>
+        const typename T::type & _get(choice<0>) const
+        {
+            auto it = _map.find(boost::typeindex::type_id<T>());
+            if (it == _map.end())
+            {
+                return _detail::_default_value<T>();
+            }
+
+            return boost::any_cast<const typename T::type &>(it->second);
+        }
+
+        template<typename T, typename std::enable_if<_detail::_has_default_value<T>::value, int>::type = 0>
+        const typename T::type & _get(choice<0>)
+        {
+            return std::as_const(*this).template _get<T>(choice<0>{});
+        }
+
+        template<typename T>
+        typename T::type & _get(choice<1>)
         {
-            return [&](auto &&... args) { _map[boost::typeindex::type_id<T>()] = typename T::type{ std::forward<decltype(args)>(args)... }; };
+            return boost::any_cast<typename T::type &>(_map.at(boost::typeindex::type_id<T>()));
+        }
+
+        template<typename T>
+        const typename T::type & _get(choice<1>) const
+        {
+            return boost::any_cast<const typename T::type &>(_map.at(boost::typeindex::type_id<T>()));
         }
 
         std::unordered_map<boost::typeindex::type_index, boost::any, boost::hash<boost::typeindex::type_index>> _map;
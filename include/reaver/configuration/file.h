@@ -0,0 +1,333 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../exception.h"
+#include "../id.h"
+#include "../tpl/vector.h"
+#include "schema.h"
+#include "static_configuration.h"
+
+namespace reaver
+{
+namespace options
+{
+    inline namespace _v1
+    {
+        class config_file_error : public exception
+        {
+        public:
+            config_file_error(std::string_view file, std::size_t line, const char * message, std::string_view detail = {}) : exception{ logger::error }
+            {
+                *this << std::string{ file } << ":" << line << ": " << message;
+                if (!detail.empty())
+                {
+                    *this << ": `" << std::string{ detail } << "`";
+                }
+                *this << ".";
+            }
+        };
+
+        class config_file_open_error : public exception
+        {
+        public:
+            config_file_open_error(const char * file) : exception{ logger::error }
+            {
+                *this << "failed to open configuration file `" << file << "`: " << std::strerror(errno) << ".";
+            }
+        };
+
+        namespace _detail
+        {
+            constexpr bool _is_blank(char c)
+            {
+                return c == ' ' || c == '\t' || c == '\r';
+            }
+
+            constexpr std::string_view _trim(std::string_view text)
+            {
+                while (!text.empty() && _is_blank(text.front()))
+                {
+                    text.remove_prefix(1);
+                }
+
+                while (!text.empty() && _is_blank(text.back()))
+                {
+                    text.remove_suffix(1);
+                }
+
+                return text;
+            }
+
+            // the value part of a `key = value` line; quoted values are unescaped into buffer, bare values end at a comment
+            inline std::string_view _config_value(std::string_view text, std::string & buffer, std::string_view file, std::size_t line)
+            {
+                if (text.empty() || text.front() != '"')
+                {
+                    for (std::size_t i = 0; i < text.size(); ++i)
+                    {
+                        if ((text[i] == '#' || text[i] == ';') && (i == 0 || _is_blank(text[i - 1])))
+                        {
+                            return _trim(text.substr(0, i));
+                        }
+                    }
+
+                    return text;
+                }
+
+                buffer.clear();
+                for (std::size_t i = 1; i < text.size(); ++i)
+                {
+                    switch (text[i])
+                    {
+                        case '"':
+                        {
+                            auto rest = _trim(text.substr(i + 1));
+                            if (!rest.empty() && rest.front() != '#' && rest.front() != ';')
+                            {
+                                throw config_file_error{ file, line, "unexpected characters after a quoted value", rest };
+                            }
+
+                            return buffer;
+                        }
+
+                        case '\\':
+                            if (++i == text.size())
+                            {
+                                break;
+                            }
+
+                            switch (text[i])
+                            {
+                                case 'n':
+                                    buffer.push_back('\n');
+                                    break;
+                                case 't':
+                                    buffer.push_back('\t');
+                                    break;
+                                case '"':
+                                case '\\':
+                                    buffer.push_back(text[i]);
+                                    break;
+                                default:
+                                    throw config_file_error{ file, line, "invalid escape sequence", text.substr(i - 1, 2) };
+                            }
+                            break;
+
+                        default:
+                            buffer.push_back(text[i]);
+                    }
+                }
+
+                throw config_file_error{ file, line, "unterminated quoted value" };
+            }
+
+            // parses an INI-style file:
+            //  - `[section]` lines make the following keys be `section.key`,
+            //  - `key = value` lines set the option with that (long) name; values can be quoted, with \" \\ \n and \t escapes,
+            //  - lines starting with `#` or `;` are comments,
+            //  - setting a vector option more than once collects all the values.
+            // calls on_value(key, value, line) for every value, in order
+            // the text is never copied; the only allocations are for the parsed values, and buffers that are reused for every line
+            template<typename F>
+            void _parse_config(std::string_view text, std::string_view file, F && on_value)
+            {
+                std::string section;
+                std::string full_key;
+                std::string value_buffer;
+
+                for (std::size_t line = 1; !text.empty(); ++line)
+                {
+                    auto newline = static_cast<const char *>(std::memchr(text.data(), '\n', text.size()));
+                    auto length = newline ? static_cast<std::size_t>(newline - text.data()) : text.size();
+                    auto current = _trim(text.substr(0, length));
+                    text.remove_prefix(newline ? length + 1 : length);
+
+                    if (current.empty() || current.front() == '#' || current.front() == ';')
+                    {
+                        continue;
+                    }
+
+                    if (current.front() == '[')
+                    {
+                        if (current.back() != ']')
+                        {
+                            throw config_file_error{ file, line, "invalid section header", current };
+                        }
+
+                        section.assign(_trim(current.substr(1, current.size() - 2)));
+                        continue;
+                    }
+
+                    auto equals = current.find('=');
+                    if (equals == std::string_view::npos)
+                    {
+                        throw config_file_error{ file, line, "expected `key = value`", current };
+                    }
+
+                    auto key = _trim(current.substr(0, equals));
+                    auto value = _config_value(_trim(current.substr(equals + 1)), value_buffer, file, line);
+
+                    if (!section.empty())
+                    {
+                        full_key.assign(section);
+                        full_key.push_back('.');
+                        full_key.append(key);
+                        key = full_key;
+                    }
+
+                    on_value(key, value, line);
+                }
+            }
+
+            template<typename Schema, typename Config>
+            auto _store_config_value(Config & config, std::string_view file)
+            {
+                return [&config, file, seen = std::array<bool, Schema::size>{}](std::string_view key, std::string_view value, std::size_t line) mutable {
+                    auto index = Schema::long_table.find(key);
+                    if (index == Schema::npos)
+                    {
+                        throw config_file_error{ file, line, "unknown key", key };
+                    }
+
+                    if (!Schema::parsers[index](value, config, !std::exchange(seen[index], true)))
+                    {
+                        throw config_file_error{ file, line, "invalid value", value };
+                    }
+                };
+            }
+
+            class _mapped_config_file
+            {
+            public:
+                _mapped_config_file(const char * path)
+                {
+                    _fd = ::open(path, O_RDONLY | O_CLOEXEC);
+                    if (_fd < 0)
+                    {
+                        throw config_file_open_error{ path };
+                    }
+
+                    struct stat info;
+                    if (::fstat(_fd, &info) < 0)
+                    {
+                        ::close(_fd);
+                        throw config_file_open_error{ path };
+                    }
+
+                    _size = info.st_size;
+                    if (!_size)
+                    {
+                        return;
+                    }
+
+                    auto data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+                    if (data == MAP_FAILED)
+                    {
+                        ::close(_fd);
+                        throw config_file_open_error{ path };
+                    }
+
+                    ::madvise(data, _size, MADV_SEQUENTIAL);
+                    _data = static_cast<const char *>(data);
+                }
+
+                _mapped_config_file(const _mapped_config_file &) = delete;
+                _mapped_config_file & operator=(const _mapped_config_file &) = delete;
+
+                ~_mapped_config_file()
+                {
+                    if (_data)
+                    {
+                        ::munmap(const_cast<char *>(_data), _size);
+                    }
+
+                    ::close(_fd);
+                }
+
+                std::string_view contents() const
+                {
+                    return { _data, _size };
+                }
+
+            private:
+                int _fd = -1;
+                const char * _data = nullptr;
+                std::size_t _size = 0;
+            };
+        }
+
+        // parses configuration file contents into a static_configuration of the given options
+        // options that aren't set in the text keep their default values; see _detail::_parse_config for the format
+        template<typename... Args>
+        auto parse_config(std::string_view text, id<Args>...)
+        {
+            using config_type = static_configuration<Args...>;
+            using schema = _detail::_option_schema<config_type, Args...>;
+
+            config_type config;
+            _detail::_parse_config(text, "<string>", _detail::_store_config_value<schema>(config, "<string>"));
+            return config;
+        }
+
+        template<typename... Args>
+        auto parse_config(std::string_view text, tpl::vector<Args...>)
+        {
+            return parse_config(text, id<Args>{}...);
+        }
+
+        // the file is mapped into memory and parsed in place
+        template<typename... Args>
+        auto parse_config_file(const char * path, id<Args>...)
+        {
+            using config_type = static_configuration<Args...>;
+            using schema = _detail::_option_schema<config_type, Args...>;
+
+            _detail::_mapped_config_file file{ path };
+
+            config_type config;
+            _detail::_parse_config(file.contents(), path, _detail::_store_config_value<schema>(config, path));
+            return config;
+        }
+
+        template<typename... Args>
+        auto parse_config_file(const char * path, tpl::vector<Args...>)
+        {
+            return parse_config_file(path, id<Args>{}...);
+        }
+    }
+}
+}
@@ -40,6 +40,7 @@
 #include "../tpl/sort.h"
 #include "../traits.h"
 #include "../unit.h"
+#include "parse.h"
 
 namespace reaver
 {
@@ -380,18 +381,6 @@ namespace options
 
         namespace _detail
         {
-            template<typename T, typename = void>
-            struct _po_type
-            {
-                using type = typename T::type;
-            };
-
-            template<typename T>
-            struct _po_type<T, std::void_t<typename T::parsed_type>>
-            {
-                using type = typename T::parsed_type;
-            };
-
             template<typename T>
             struct _remove_optional
             {
@@ -541,7 +530,7 @@ namespace options
                             map.at(_name(Head::name)).template as<typename _remove_optional<typename _po_type<Head>::type>::type>()));
                 }
 
-                return _get<Tail...>(map, std::forward<Config>(config).template add<Head>(decltype(Head::default_value){ Head::default_value }));
+                return _get<Tail...>(map, std::forward<Config>(config).template add<Head>(reaver::_detail::_default_value<Head>()));
             }
 
             // TODO: convert all these to choice<N>/select_overload somehow
@@ -0,0 +1,170 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../overloads.h"
+#include "../traits.h"
+
+namespace reaver
+{
+namespace options
+{
+    inline namespace _v1
+    {
+        namespace _detail
+        {
+            template<typename T, typename = void>
+            struct _po_type
+            {
+                using type = typename T::type;
+            };
+
+            template<typename T>
+            struct _po_type<T, std::void_t<typename T::parsed_type>>
+            {
+                using type = typename T::parsed_type;
+            };
+
+            // parsing of option values from text; returns false if the text isn't a valid value of the type
+            // none of these allocate, other than for the parsed value itself
+            inline bool _parse_value(std::string_view text, bool & value)
+            {
+                if (text == "true" || text == "yes" || text == "on" || text == "1")
+                {
+                    value = true;
+                    return true;
+                }
+
+                if (text == "false" || text == "no" || text == "off" || text == "0")
+                {
+                    value = false;
+                    return true;
+                }
+
+                return false;
+            }
+
+            template<typename T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+            bool _parse_value(std::string_view text, T & value)
+            {
+                if (!text.empty() && text.front() == '+')
+                {
+                    text.remove_prefix(1);
+                }
+
+                auto end = text.data() + text.size();
+                auto result = std::from_chars(text.data(), end, value);
+                return result.ec == std::errc{} && result.ptr == end;
+            }
+
+            inline bool _parse_value(std::string_view text, std::string & value)
+            {
+                value.assign(text.data(), text.size());
+                return true;
+            }
+
+            template<typename T>
+            bool _parse_value(std::string_view text, std::optional<T> & value)
+            {
+                T parsed{};
+                if (!_parse_value(text, parsed))
+                {
+                    return false;
+                }
+
+                value = std::move(parsed);
+                return true;
+            }
+
+            // a vector option that is given a value more than once collects all of the values
+            template<typename T, typename A>
+            bool _parse_value(std::string_view text, std::vector<T, A> & value)
+            {
+                T parsed{};
+                if (!_parse_value(text, parsed))
+                {
+                    return false;
+                }
+
+                value.push_back(std::move(parsed));
+                return true;
+            }
+
+            // stores the value of tag T parsed from text into config; first tells whether it's the first value the source gives it
+            // the first value of a vector option replaces its default value, and later ones are appended, unless the option doesn't
+            // allow composing, in which case every value replaces the previous one
+            template<typename T, typename Config, typename std::enable_if<is_vector<typename T::type>::value, int>::type = 0>
+            bool _parse_into(choice<0>, std::string_view text, Config & config, bool first)
+            {
+                typename T::type::value_type parsed{};
+                if (!_parse_value(text, parsed))
+                {
+                    return false;
+                }
+
+                auto & values = config.template get<T>();
+                if (first || !T::options.allows_composing)
+                {
+                    values.clear();
+                }
+
+                values.push_back(std::move(parsed));
+                return true;
+            }
+
+            template<typename T, typename Config>
+            bool _parse_into(choice<1>, std::string_view text, Config & config, bool)
+            {
+                typename _po_type<T>::type value{};
+                if (!_parse_value(text, value))
+                {
+                    return false;
+                }
+
+                config.template set<T>(std::move(value));
+                return true;
+            }
+
+            template<typename T, typename Config>
+            bool _parse_into(std::string_view text, Config & config, bool first)
+            {
+                return _parse_into<T>(select_overload{}, text, config, first);
+            }
+
+            // the name an option is referred to by in places other than the command line, i.e. the long name
+            constexpr std::string_view _long_name(std::string_view name)
+            {
+                return name.substr(0, name.find(','));
+            }
+        }
+    }
+}
+}
@@ -0,0 +1,203 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "../overloads.h"
+#include "../perfect_hash.h"
+#include "../traits.h"
+#include "parse.h"
+#include "static_configuration.h"
+
+namespace reaver
+{
+namespace options
+{
+    inline namespace _v1
+    {
+        namespace _detail
+        {
+            template<typename T, typename std::enable_if<T::options.position_specified, int>::type = 0>
+            constexpr std::string_view _option_name(choice<0>)
+            {
+                return {};
+            }
+
+            template<typename T>
+            constexpr std::string_view _option_name(choice<1>)
+            {
+                return _long_name(T::name);
+            }
+
+            template<typename T, typename std::enable_if<T::options.position_specified, int>::type = 0>
+            constexpr char _short_name(choice<0>)
+            {
+                return 0;
+            }
+
+            template<typename T>
+            constexpr char _short_name(choice<1>)
+            {
+                std::string_view name = T::name;
+                auto comma = name.find(',');
+                return comma != std::string_view::npos && comma + 1 < name.size() ? name[comma + 1] : 0;
+            }
+
+            // options that can't be left out: not flags, not optional, not vectors and without a default value
+            template<typename T>
+            constexpr bool _is_required()
+            {
+                return !T::is_void && !is_optional<typename T::type>::value && !is_vector<typename T::type>::value
+                    && !reaver::_detail::_has_default_value<T>::value;
+            }
+
+            // the name of the environment variable an option is read from: T::env if it's specified, otherwise
+            // the long name in upper case, with everything other than letters and digits replaced by underscores
+            // (and then prefixed with the prefix given to parse_options at runtime)
+            template<typename T>
+            struct _derived_env_name
+            {
+                static constexpr std::string_view name = _option_name<T>(select_overload{});
+                static constexpr std::array<char, name.size() + 1> storage = [] {
+                    std::array<char, name.size() + 1> ret{};
+                    for (std::size_t i = 0; i < name.size(); ++i)
+                    {
+                        auto c = name[i];
+                        ret[i] = c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ? c : '_';
+                    }
+                    return ret;
+                }();
+                static constexpr std::string_view value{ storage.data(), name.size() };
+            };
+
+            template<typename T, typename std::enable_if<std::is_void<decltype(T::env, void())>::value, int>::type = 0>
+            constexpr std::string_view _explicit_env_name(choice<0>)
+            {
+                return T::env;
+            }
+
+            template<typename T>
+            constexpr std::string_view _explicit_env_name(choice<1>)
+            {
+                return {};
+            }
+
+            template<typename T, typename std::enable_if<std::is_void<decltype(T::env, void())>::value, int>::type = 0>
+            constexpr std::string_view _prefixed_env_name(choice<0>)
+            {
+                return {};
+            }
+
+            template<typename T>
+            constexpr std::string_view _prefixed_env_name(choice<1>)
+            {
+                return _derived_env_name<T>::value;
+            }
+
+            // everything needed to find and parse the options in any of the sources, computed at compile time
+            // options are referred to by their index in Args...
+            template<typename Config, typename... Args>
+            struct _option_schema
+            {
+                static constexpr std::size_t size = sizeof...(Args);
+                static constexpr std::size_t npos = perfect_hash<size>::npos;
+
+                static constexpr std::array<std::string_view, size> long_names = { { _option_name<Args>(select_overload{})... } };
+                static constexpr perfect_hash<size> long_table{ long_names };
+
+                static constexpr std::array<std::string_view, size> explicit_env_names = { { _explicit_env_name<Args>(select_overload{})... } };
+                static constexpr perfect_hash<size> explicit_env_table{ explicit_env_names };
+                static constexpr std::array<std::string_view, size> prefixed_env_names = { { _prefixed_env_name<Args>(select_overload{})... } };
+                static constexpr perfect_hash<size> prefixed_env_table{ prefixed_env_names };
+
+                static constexpr std::array<char, size> short_names = { { _short_name<Args>(select_overload{})... } };
+                static constexpr std::array<std::size_t, 256> short_table = [] {
+                    std::array<std::size_t, 256> table{};
+                    for (auto & entry : table)
+                    {
+                        entry = npos;
+                    }
+
+                    for (std::size_t i = 0; i < size; ++i)
+                    {
+                        if (short_names[i])
+                        {
+                            if (table[static_cast<unsigned char>(short_names[i])] != npos)
+                            {
+                                throw std::logic_error{ "duplicate short option name" };
+                            }
+
+                            table[static_cast<unsigned char>(short_names[i])] = i;
+                        }
+                    }
+
+                    return table;
+                }();
+
+                static constexpr std::array<bool, size> is_flag = { { Args::is_void... } };
+                static constexpr std::array<bool, size> is_required = { { _is_required<Args>()... } };
+                static constexpr std::array<bool (*)(std::string_view, Config &, bool), size> parsers = { { &_parse_into<Args, Config>... } };
+
+                static constexpr std::array<bool, size> is_positional = { { Args::options.position_specified... } };
+                static constexpr std::array<std::size_t, size> positions = { { Args::options.position.required_position... } };
+                static constexpr std::array<std::size_t, size> position_counts = { { Args::options.position.count... } };
+
+                // indices of the positional options, in the order of their positions
+                static constexpr std::size_t positional_count = (0 + ... + (Args::options.position_specified ? 1 : 0));
+                static constexpr std::array<std::size_t, positional_count> positional = [] {
+                    std::array<std::size_t, positional_count> ret{};
+                    std::size_t count = 0;
+
+                    for (std::size_t i = 0; i < size; ++i)
+                    {
+                        if (!is_positional[i])
+                        {
+                            continue;
+                        }
+
+                        auto j = count++;
+                        for (; j > 0 && positions[ret[j - 1]] > positions[i]; --j)
+                        {
+                            ret[j] = ret[j - 1];
+                        }
+                        ret[j] = i;
+                    }
+
+                    return ret;
+                }();
+
+                static const char * display_name(std::size_t index)
+                {
+                    static const char * const names[] = { Args::name..., nullptr };
+                    return names[index];
+                }
+            };
+        }
+    }
+}
+}
@@ -0,0 +1,237 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/type_index.hpp>
+
+#include "../executor.h"
+#include "../function.h"
+#include "../hazard_pointer.h"
+#include "../unit.h"
+#include "configuration.h"
+
+namespace reaver
+{
+inline namespace _v1
+{
+    // an immutable view of a shared_configuration, as of the time it was taken
+    template<typename Config>
+    class configuration_snapshot
+    {
+    public:
+        configuration_snapshot(const std::atomic<const Config *> & source) : _config{ _hazard.protect(source) }
+        {
+        }
+
+        template<typename T>
+        decltype(auto) get(T = {}) const
+        {
+            return _config->template get<T>();
+        }
+
+        const Config & operator*() const
+        {
+            return *_config;
+        }
+
+        const Config * operator->() const
+        {
+            return _config;
+        }
+
+    private:
+        hazard_pointer _hazard;
+        const Config * _config;
+    };
+
+    // a configuration that can be read and updated from many threads at once
+    // readers take a snapshot, which costs an atomic load and publishing a hazard pointer, and never block
+    // writers copy the current configuration, modify the copy and publish it atomically; writers are serialized
+    // a snapshot keeps seeing the values from the time it was taken; old configurations are deleted once no snapshot uses them
+    // on_change() subscribers are notified once per update() that sets their tag, no matter how many times it was set
+    template<typename Config = configuration>
+    class shared_configuration
+    {
+    public:
+        shared_configuration(Config config = {}) : _current{ new Config(std::move(config)) }
+        {
+        }
+
+        shared_configuration(const shared_configuration &) = delete;
+        shared_configuration & operator=(const shared_configuration &) = delete;
+
+        // there must not be any snapshots of this configuration left when it's destroyed
+        ~shared_configuration()
+        {
+            delete _current.load();
+            for (auto config : _retired)
+            {
+                delete config;
+            }
+        }
+
+        configuration_snapshot<Config> snapshot() const
+        {
+            return { _current };
+        }
+
+        // returns a copy; use snapshot() to avoid copying, or to read several values that are consistent with each other
+        template<typename T>
+        typename T::type get(T = {}) const
+        {
+            return snapshot().template get<T>();
+        }
+
+        // calls f with a copy of the current configuration, and then publishes the modified copy
+        // all of the changes made by f become visible at once; if f throws, nothing is published
+        template<typename F>
+        unit update(F && f)
+        {
+            std::lock_guard<std::mutex> lock{ _write_lock };
+
+            auto next = std::make_unique<Config>(*_current.load(std::memory_order_relaxed));
+
+            _detail::_change_journal_type journal;
+            {
+                struct _journal_scope
+                {
+                    _journal_scope(_detail::_change_journal_type * journal) : previous{ std::exchange(_detail::_change_journal(), journal) }
+                    {
+                    }
+
+                    ~_journal_scope()
+                    {
+                        _detail::_change_journal() = previous;
+                    }
+
+                    _detail::_change_journal_type * previous;
+                } scope{ &journal };
+
+                std::forward<F>(f)(*next);
+            }
+
+            _retired.reserve(_retired.size() + 1);
+            auto & published = *next;
+            _retired.push_back(_current.exchange(next.release()));
+            retire_if_unused(_retired);
+
+            _notify(published, journal);
+
+            return {};
+        }
+
+        // calls f(value) on sched with the new value of tag T after every update() that sets it
+        // returns an identifier that can be passed to unsubscribe()
+        template<typename T, typename F>
+        std::size_t on_change(std::shared_ptr<executor> sched, F f)
+        {
+            std::lock_guard<std::mutex> lock{ _write_lock };
+
+            auto id = _next_subscription++;
+            _subscriptions[boost::typeindex::type_id<T>()].push_back(
+                { id, [sched = std::move(sched), f = std::make_shared<F>(std::move(f))](const Config & config) {
+                     sched->push([f, value = config.template get<T>()]() { (*f)(value); });
+                 } });
+
+            return id;
+        }
+
+        // notifications that were already pushed to their executor still run
+        unit unsubscribe(std::size_t id)
+        {
+            std::lock_guard<std::mutex> lock{ _write_lock };
+
+            for (auto && subscriptions : _subscriptions)
+            {
+                auto & list = subscriptions.second;
+                list.erase(std::remove_if(list.begin(), list.end(), [&](auto && subscription) { return subscription.id == id; }), list.end());
+            }
+
+            return {};
+        }
+
+        template<typename T, typename... Args>
+        unit set(Args &&... args)
+        {
+            return update([&](Config & config) { config.template set<T>(std::forward<Args>(args)...); });
+        }
+
+        template<typename T, typename... Args>
+        unit set(T, Args &&... args)
+        {
+            return set<T>(std::forward<Args>(args)...);
+        }
+
+    private:
+        void _notify(const Config & config, _detail::_change_journal_type & journal)
+        {
+            std::vector<boost::typeindex::type_index> changed;
+            for (auto && entry : journal)
+            {
+                if (entry.first == &config && std::find(changed.begin(), changed.end(), entry.second) == changed.end())
+                {
+                    changed.push_back(entry.second);
+                }
+            }
+
+            for (auto && tag : changed)
+            {
+                auto it = _subscriptions.find(tag);
+                if (it == _subscriptions.end())
+                {
+                    continue;
+                }
+
+                for (auto && subscription : it->second)
+                {
+                    subscription.notify(config);
+                }
+            }
+        }
+
+        struct _subscription
+        {
+            std::size_t id;
+            unique_function<void(const Config &)> notify;
+        };
+
+        std::atomic<const Config *> _current;
+
+        std::mutex _write_lock;
+        std::vector<const Config *> _retired;
+
+        std::size_t _next_subscription = 0;
+        std::unordered_map<boost::typeindex::type_index, std::vector<_subscription>, boost::hash<boost::typeindex::type_index>> _subscriptions;
+    };
+}
+}
@@ -0,0 +1,175 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+#include <unistd.h>
+
+#include "../id.h"
+#include "../tpl/vector.h"
+#include "argv.h"
+#include "file.h"
+#include "schema.h"
+#include "static_configuration.h"
+
+namespace reaver
+{
+namespace options
+{
+    inline namespace _v1
+    {
+        // where parse_options takes the values of options from
+        // an option set in more than one of them takes the value from the first of: argv, environment, config file; options set in
+        // none of them keep their default values
+        struct option_sources
+        {
+            int argc = 0;
+            const char * const * argv = nullptr;
+
+            // a `NAME=value` array terminated by a null pointer, like environ
+            const char * const * environment = nullptr;
+            // options without an explicit `env` name are read from env_prefix followed by their long name in upper case,
+            // with every character other than letters and digits replaced by an underscore; nullptr disables that
+            const char * env_prefix = nullptr;
+
+            const char * config_file = nullptr;
+        };
+
+        inline const char * const * process_environment()
+        {
+            return ::environ;
+        }
+
+        namespace _detail
+        {
+            enum class _option_source : unsigned char
+            {
+                none,
+                file,
+                environment,
+                argv
+            };
+        }
+
+        // resolves the values of the given options from all of the sources, in a single pass over each source
+        // every source is looked up in the same compile-time tables, and every value is parsed at most once: the sources are
+        // read from the highest precedence to the lowest, and values of options already set by a higher one are skipped
+        template<typename... Args>
+        auto parse_options(const option_sources & sources, id<Args>...)
+        {
+            using config_type = static_configuration<Args...>;
+            using schema = _detail::_option_schema<config_type, Args...>;
+            using _detail::_option_source;
+
+            config_type config;
+            std::array<_option_source, sizeof...(Args)> set_by{};
+
+            // returns false if the value is invalid
+            auto store = [&](_option_source source, std::size_t index, std::string_view value) {
+                if (set_by[index] > source)
+                {
+                    return true;
+                }
+
+                auto first = std::exchange(set_by[index], source) != source;
+                return schema::parsers[index](value, config, first);
+            };
+
+            if (sources.argv)
+            {
+                _detail::_parse_argv<schema>(sources.argc, sources.argv, [&](std::size_t index, std::string_view argument, std::string_view value) {
+                    if (!store(_option_source::argv, index, value))
+                    {
+                        throw invalid_option_value{ argument, value };
+                    }
+                });
+            }
+
+            if (sources.environment)
+            {
+                std::string_view prefix = sources.env_prefix ? sources.env_prefix : "";
+
+                for (auto entry = sources.environment; *entry; ++entry)
+                {
+                    std::string_view variable = *entry;
+                    auto equals = variable.find('=');
+                    if (equals == std::string_view::npos)
+                    {
+                        continue;
+                    }
+
+                    auto name = variable.substr(0, equals);
+                    auto index = schema::explicit_env_table.find(name);
+                    if (index == schema::npos && sources.env_prefix && name.substr(0, prefix.size()) == prefix)
+                    {
+                        index = schema::prefixed_env_table.find(name.substr(prefix.size()));
+                    }
+
+                    if (index != schema::npos && !store(_option_source::environment, index, variable.substr(equals + 1)))
+                    {
+                        throw invalid_option_value{ name, variable.substr(equals + 1) };
+                    }
+                }
+            }
+
+            if (sources.config_file)
+            {
+                _detail::_mapped_config_file file{ sources.config_file };
+                std::string_view path = sources.config_file;
+
+                _detail::_parse_config(file.contents(), path, [&](std::string_view key, std::string_view value, std::size_t line) {
+                    auto index = schema::long_table.find(key);
+                    if (index == schema::npos)
+                    {
+                        throw config_file_error{ path, line, "unknown key", key };
+                    }
+
+                    if (!store(_option_source::file, index, value))
+                    {
+                        throw config_file_error{ path, line, "invalid value", value };
+                    }
+                });
+            }
+
+            std::array<bool, sizeof...(Args)> seen{};
+            for (std::size_t i = 0; i < sizeof...(Args); ++i)
+            {
+                seen[i] = set_by[i] != _option_source::none;
+            }
+            _detail::_check_required<schema>(seen);
+
+            return config;
+        }
+
+        template<typename... Args>
+        auto parse_options(const option_sources & sources, tpl::vector<Args...>)
+        {
+            return parse_options(sources, id<Args>{}...);
+        }
+    }
+}
+}
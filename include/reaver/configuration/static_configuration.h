@@ -0,0 +1,104 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "../overloads.h"
+#include "../tpl/index_of.h"
+#include "../tpl/vector.h"
+#include "../unit.h"
+#include "configuration.h"
+
+namespace reaver
+{
+inline namespace _v1
+{
+    namespace _detail
+    {
+        template<typename T, typename std::enable_if<_has_default_value<T>::value, int>::type = 0>
+        typename T::type _initial_value(choice<0>)
+        {
+            return _default_value<T>();
+        }
+
+        template<typename T>
+        typename T::type _initial_value(choice<1>)
+        {
+            return typename T::type{};
+        }
+    }
+
+    // a configuration with a set of tags fixed at compile time; the values are stored directly in a tuple,
+    // so get<T>() is a plain member access, without any lookups or casts
+    // values of tags that have a default_value start out as that value, the others are value-initialized
+    // setting values works exactly the same way it does for configuration
+    template<typename... Tags>
+    class static_configuration
+    {
+    public:
+        static_configuration() : _values{ _detail::_initial_value<Tags>(select_overload{})... }
+        {
+        }
+
+        // throws std::out_of_range if any of the tags is not set in config, just like bound_configuration
+        static_configuration(const configuration & config) : _values{ config.get<Tags>()... }
+        {
+        }
+
+        template<typename T, typename... Args, typename std::enable_if<(std::is_same<T, Tags>::value || ...), int>::type = 0>
+        unit set(Args &&... args)
+        {
+            std::get<_index<T>>(_values) = _detail::_make_value<T, std::tuple<Args...>>(select_overload{})(std::forward<Args>(args)...);
+            _detail::_record_change<T>(this);
+            return {};
+        }
+
+        template<typename T, typename... Args, typename std::enable_if<(std::is_same<T, Tags>::value || ...), int>::type = 0>
+        unit set(T, Args &&... args)
+        {
+            return set<T>(std::forward<Args>(args)...);
+        }
+
+        template<typename T, typename std::enable_if<(std::is_same<T, Tags>::value || ...), int>::type = 0>
+        auto & get(T = {})
+        {
+            return std::get<_index<T>>(_values);
+        }
+
+        template<typename T, typename std::enable_if<(std::is_same<T, Tags>::value || ...), int>::type = 0>
+        auto & get(T = {}) const
+        {
+            return std::get<_index<T>>(_values);
+        }
+
+    private:
+        template<typename T>
+        static constexpr std::size_t _index = tpl::index_of<tpl::vector<Tags...>, T>::value;
+
+        std::tuple<typename Tags::type...> _values;
+    };
+}
+}
@@ -53,8 +53,6 @@ inline namespace _v1
             {
                 throw invalid_exception_level{};
             }
-
-            _streamables = logger::default_level_registry()[l];
         }
 
         exception(const exception &) = default;
@@ -94,7 +92,7 @@ inline namespace _v1
             auto streamables = _streamables;
             streamables.emplace_back('\n');
 
-            logger_friend::_write(l, std::move(streamables));
+            logger_friend::_write(l, _level, std::move(streamables));
         }
 
         friend reaver::logger::logger & operator<<(reaver::logger::logger &, const exception &);
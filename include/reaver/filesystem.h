@@ -1,7 +1,7 @@
 /**
  * Reaver Library Licence
  *
- * Copyright © 2014, 2016-2017 Michał "Griwes" Dominiak
+ * Copyright © 2014, 2016-2017, 2026 Michał "Griwes" Dominiak
  *
  * This software is provided 'as-is', without any express or implied
  * warranty. In no event will the authors be held liable for any damages
@@ -22,8 +22,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include <boost/filesystem.hpp>
 
+#include "executor.h"
+#include "filesystem/directory.h"
+#include "filesystem/directory_cache.h"
+#include "future.h"
 #include "wildcard.h"
 
 namespace reaver
@@ -32,113 +45,667 @@ namespace filesystem
 {
     inline namespace _v1
     {
-        inline boost::filesystem::path make_relative(const boost::filesystem::path & path,
-            const boost::filesystem::path & base = boost::filesystem::current_path())
+        namespace _detail
         {
-            auto absolute_base = boost::filesystem::absolute(base);
-            auto absolute_path = boost::filesystem::absolute(path);
+            // walks the components of a path, skipping empty ones and `.`; `..` is kept as it is, since resolving it would need the filesystem
+            class _component_cursor
+            {
+            public:
+                _component_cursor(std::string_view path) : _path{ path }
+                {
+                }
+
+                // returns an empty view once there are no more components
+                std::string_view next()
+                {
+                    while (_position < _path.size())
+                    {
+                        auto end = std::min(_path.find('/', _position), _path.size());
+                        auto component = _path.substr(_position, end - _position);
+                        _position = end + 1;
+
+                        if (!component.empty() && component != ".")
+                        {
+                            return component;
+                        }
+                    }
+
+                    return {};
+                }
+
+            private:
+                std::string_view _path;
+                std::size_t _position = 0;
+            };
 
-            if (absolute_base == absolute_path)
+            inline std::vector<std::string_view> _components(std::string_view path)
             {
-                return {};
+                std::vector<std::string_view> ret;
+
+                _component_cursor cursor{ path };
+                for (auto component = cursor.next(); !component.empty(); component = cursor.next())
+                {
+                    ret.push_back(component);
+                }
+
+                return ret;
             }
+        }
 
-            boost::filesystem::path relative;
+        // an absolute base directory, resolved once, for making any number of paths relative to it without touching the filesystem
+        // relative paths given to relative() are taken to be relative to the working directory at the time the base was created,
+        // if the base itself was relative, or to the current working directory otherwise
+        class relative_base
+        {
+        public:
+            relative_base() : relative_base{ boost::filesystem::current_path() }
+            {
+            }
 
-            auto base_it = absolute_base.begin();
-            auto path_it = absolute_path.begin();
+            relative_base(const boost::filesystem::path & base)
+                : _cwd{ base.is_absolute() ? std::string{} : boost::filesystem::current_path().string() },
+                  _base{ base.is_absolute() ? base.string() : _cwd + '/' + base.string() },
+                  _cwd_components{ _detail::_components(_cwd) },
+                  _base_components{ _detail::_components(_base) }
+            {
+            }
 
-            if (*base_it != *path_it)
+            // the components point into the strings, so they are found again instead of being copied
+            relative_base(const relative_base & other)
+                : _cwd{ other._cwd }, _base{ other._base }, _cwd_components{ _detail::_components(_cwd) }, _base_components{ _detail::_components(_base) }
             {
-                return path;
             }
 
-            while (base_it != absolute_base.end() && path_it != absolute_path.end() && *base_it == *path_it)
+            relative_base & operator=(const relative_base &) = delete;
+
+            // the absolute path of the base, as given; it isn't normalized
+            const std::string & path() const
             {
-                ++base_it;
-                ++path_it;
+                return _base;
             }
 
-            while (base_it != absolute_base.end())
+            // appends path, made relative to the base, to out; an empty string means the base itself
+            void relative(std::string_view path, std::string & out) const
             {
-                relative /= "..";
-                ++base_it;
+                // the components of the absolute path are the working directory's, followed by the path's own, for relative paths
+                const std::vector<std::string_view> * prefix = nullptr;
+                std::string cwd;
+                std::vector<std::string_view> cwd_components;
+
+                if (path.empty() || path.front() != '/')
+                {
+                    prefix = &_cwd_components;
+                    if (_cwd.empty())
+                    {
+                        cwd = boost::filesystem::current_path().string();
+                        cwd_components = _detail::_components(cwd);
+                        prefix = &cwd_components;
+                    }
+                }
+
+                std::size_t prefix_position = 0;
+                _detail::_component_cursor cursor{ path };
+
+                auto next = [&]() -> std::string_view {
+                    if (prefix && prefix_position < prefix->size())
+                    {
+                        return (*prefix)[prefix_position++];
+                    }
+
+                    return cursor.next();
+                };
+
+                std::size_t common = 0;
+                auto component = next();
+                while (common < _base_components.size() && !component.empty() && component == _base_components[common])
+                {
+                    ++common;
+                    component = next();
+                }
+
+                auto start = out.size();
+                auto append = [&](std::string_view component) {
+                    if (out.size() != start)
+                    {
+                        out.push_back('/');
+                    }
+                    out.append(component);
+                };
+
+                for (auto i = common; i < _base_components.size(); ++i)
+                {
+                    append("..");
+                }
+
+                for (; !component.empty(); component = next())
+                {
+                    append(component);
+                }
             }
 
-            while (path_it != absolute_path.end())
+            std::string relative(std::string_view path) const
             {
-                relative /= *path_it;
-                ++path_it;
+                std::string ret;
+                relative(path, ret);
+                return ret;
             }
 
-            return relative;
+        private:
+            std::string _cwd;
+            std::string _base;
+            std::vector<std::string_view> _cwd_components;
+            std::vector<std::string_view> _base_components;
+        };
+
+        inline boost::filesystem::path make_relative(const boost::filesystem::path & path, const relative_base & base)
+        {
+            return base.relative(path.string());
+        }
+
+        inline boost::filesystem::path make_relative(const boost::filesystem::path & path, const boost::filesystem::path & base)
+        {
+            return make_relative(path, relative_base{ base });
         }
 
-        inline std::vector<boost::filesystem::path> wildcard(const std::string & pat, const boost::filesystem::path & base = boost::filesystem::current_path())
+        inline boost::filesystem::path make_relative(const boost::filesystem::path & path)
         {
-            auto pattern = make_relative(base / pat);
-            std::vector<boost::filesystem::path> state{ make_relative(base) };
-            auto end = boost::filesystem::directory_iterator{};
+            return make_relative(path, relative_base{});
+        }
 
-            for (auto && segment : boost::filesystem::path(pattern))
+        namespace _detail
+        {
+            // a single segment of a pattern, compiled once for every directory entry it's matched against
+            struct _wildcard_segment
             {
-                auto last_state = std::move(state);
+                _wildcard_segment(std::string text) : text{ std::move(text) }, pattern{ this->text }, any{ this->text == "*" }, recursive{ this->text == "**" }
+                {
+                }
 
-                if (segment == "*")
+                bool matches(std::string_view name) const
                 {
-                    for (auto && candidate : last_state)
+                    return any || recursive || pattern.matches(name);
+                }
+
+                std::string text;
+                wildcard::compiled_pattern pattern;
+                bool any;
+                bool recursive;
+            };
+
+            // the pattern split into segments, with `.` dropped; absolute patterns start at the root, and produce absolute paths
+            struct _wildcard_pattern
+            {
+                std::string start;
+                std::vector<_wildcard_segment> segments;
+            };
+
+            inline _wildcard_pattern _split_pattern(const std::string & pattern)
+            {
+                _wildcard_pattern ret;
+
+                boost::filesystem::path pattern_path{ pattern };
+                if (pattern_path.has_root_directory())
+                {
+                    ret.start = pattern_path.root_path().string();
+                    pattern_path = pattern_path.relative_path();
+                }
+
+                for (auto && segment : pattern_path)
+                {
+                    if (segment != ".")
                     {
-                        if (!boost::filesystem::is_directory(base / candidate))
-                        {
-                            continue;
-                        }
+                        ret.segments.emplace_back(segment.string());
+                    }
+                }
+
+                return ret;
+            }
+
+            // where the wildcard code gets directory contents from: the disk, through a directory opened at the base
+            struct _disk_source
+            {
+                bool is_directory(const std::string & path, entry_type type) const
+                {
+                    return _is_directory(base.fd(), _relative_name(path), type);
+                }
 
-                        for (auto it = boost::filesystem::directory_iterator{ base / std::move(candidate) }; it != end; ++it)
+                // returns entry_type::unknown if there is nothing at path
+                entry_type type(const std::string & path) const
+                {
+                    return _stat_type(base.fd(), _relative_name(path), false);
+                }
+
+                // calls f(name, type) for every entry of the directory at path; the type is never entry_type::unknown
+                template<typename F>
+                void list(const std::string & path, char * buffer, F && f) const
+                {
+                    directory dir{ base, _relative_name(path) };
+                    dir.for_each(buffer, [&](std::string_view name, entry_type type) {
+                        // names come from a getdents64 record, so they are null-terminated
+                        if (type == entry_type::unknown)
                         {
-                            state.push_back(make_relative(*it, base));
+                            type = _stat_type(dir.fd(), name.data(), false);
                         }
+
+                        f(name, type);
+                    });
+                }
+
+                directory base;
+            };
+
+            // ...or a directory_cache, where root is the absolute path of the base
+            struct _cached_source
+            {
+                bool is_directory(const std::string & path, entry_type type) const
+                {
+                    return _is_directory(AT_FDCWD, _key(path).c_str(), type);
+                }
+
+                entry_type type(const std::string & path) const
+                {
+                    auto key = _key(path);
+                    auto slash = key.rfind('/');
+                    auto name = std::string_view{ key }.substr(slash + 1);
+
+                    if (slash == std::string::npos || name.empty() || name == "." || name == "..")
+                    {
+                        return _stat_type(AT_FDCWD, key.c_str(), false);
                     }
+
+                    return cache->list(slash ? key.substr(0, slash) : "/")->find(name);
                 }
 
-                else if (segment == "**")
+                template<typename F>
+                void list(const std::string & path, char *, F && f) const
                 {
-                    auto end = boost::filesystem::recursive_directory_iterator{};
-                    for (auto && candidate : last_state)
+                    cache->list(_key(path))->for_each(f);
+                }
+
+                std::string _key(const std::string & path) const
+                {
+                    if (path.empty())
                     {
-                        if (!boost::filesystem::is_directory(base / candidate))
-                        {
-                            continue;
-                        }
+                        return root;
+                    }
 
-                        state.push_back(candidate);
-                        for (auto it = boost::filesystem::recursive_directory_iterator{ base / std::move(candidate) }; it != end; ++it)
-                        {
-                            state.push_back(make_relative(*it, base));
-                        }
+                    if (path.front() == '/')
+                    {
+                        return path;
+                    }
+
+                    auto key = root;
+                    _append_name(key, path);
+                    return key;
+                }
+
+                directory_cache * cache;
+                std::string root;
+            };
+
+            // path is relative to base, and matches the first `index` segments of the pattern
+            template<typename Source, typename Emit, typename Descend>
+            void _wildcard_visit(const Source & source,
+                const std::vector<_wildcard_segment> & segments,
+                std::string & path,
+                std::size_t index,
+                entry_type type,
+                Emit & emit,
+                Descend & descend)
+            {
+                if (index == segments.size())
+                {
+                    emit(path);
+                    return;
+                }
+
+                if (source.is_directory(path, type))
+                {
+                    descend(path, index);
+                }
+            }
+
+            // matches the entries of the directory at path against segments[index]; every entry that matches is passed to
+            // on_child(path, index + 1, type), and every directory that `**` has to look into is passed to descend(path, index)
+            // the types of the entries come from the source, so nothing here needs a stat of its own
+            template<typename Source, typename OnChild, typename Descend>
+            void _wildcard_expand(const Source & source,
+                const std::vector<_wildcard_segment> & segments,
+                std::string & path,
+                std::size_t index,
+                char * buffer,
+                OnChild && on_child,
+                Descend && descend)
+            {
+                const auto & segment = segments[index];
+                auto length = path.size();
+
+                if (segment.recursive)
+                {
+                    on_child(path, index + 1, entry_type::directory);
+                }
+
+                else if (segment.pattern.is_literal())
+                {
+                    _append_name(path, segment.text);
+                    auto type = source.type(path);
+                    if (type != entry_type::unknown)
+                    {
+                        on_child(path, index + 1, type);
                     }
+
+                    path.resize(length);
+                    return;
+                }
+
+                source.list(path, buffer, [&](std::string_view name, entry_type type) {
+                    if (!segment.matches(name))
+                    {
+                        return;
+                    }
+
+                    _append_name(path, name);
+
+                    // like recursive_directory_iterator, this doesn't descend into symlinked directories
+                    if (segment.recursive && type == entry_type::directory)
+                    {
+                        descend(path, index);
+                    }
+
+                    else
+                    {
+                        on_child(path, index + 1, type);
+                    }
+
+                    path.resize(length);
+                });
+            }
+
+            template<typename Source, typename Emit>
+            void _wildcard(const Source & source,
+                const std::vector<_wildcard_segment> & segments,
+                std::string & path,
+                std::size_t index,
+                std::size_t level,
+                _directory_arena & arena,
+                Emit & emit)
+            {
+                auto descend = [&](std::string & path, std::size_t index) { _wildcard(source, segments, path, index, level + 1, arena, emit); };
+                auto on_child = [&](std::string & path, std::size_t index, entry_type type) {
+                    _wildcard_visit(source, segments, path, index, type, emit, descend);
+                };
+
+                _wildcard_expand(source, segments, path, index, arena.buffer(level), on_child, descend);
+            }
+
+            template<typename MakeSource>
+            std::vector<boost::filesystem::path> _wildcard(const std::string & pattern, const boost::filesystem::path & base, MakeSource && make_source)
+            {
+                auto split = _split_pattern(pattern);
+                std::vector<boost::filesystem::path> ret;
+
+                auto emit = [&](const std::string & path) { ret.emplace_back(path); };
+                if (split.segments.empty())
+                {
+                    emit(split.start);
+                    return ret;
+                }
+
+                auto root = split.start.empty() ? base : boost::filesystem::path{ split.start };
+                if (!boost::filesystem::is_directory(root))
+                {
+                    return ret;
+                }
+
+                auto source = make_source(root);
+                _directory_arena arena;
+
+                auto descend = [&](std::string & path, std::size_t index) { _wildcard(source, split.segments, path, index, 0, arena, emit); };
+                _wildcard_visit(source, split.segments, split.start, 0, entry_type::unknown, emit, descend);
+
+                return ret;
+            }
+
+            inline _cached_source _make_cached_source(directory_cache & cache, const boost::filesystem::path & root)
+            {
+                cache.refresh();
+                return { &cache, root.is_absolute() ? root.string() : relative_base{ root }.path() };
+            }
+        }
+
+        // returns the paths matching the pattern, relative to base; absolute patterns produce absolute paths
+        // `*` and `?` match within a single path segment, and a `**` segment matches any number of directories
+        inline std::vector<boost::filesystem::path> wildcard(const std::string & pattern, const boost::filesystem::path & base = boost::filesystem::current_path())
+        {
+            return _detail::_wildcard(pattern, base, [](const boost::filesystem::path & root) { return _detail::_disk_source{ directory{ root.c_str() } }; });
+        }
+
+        // same as above, but directories are listed through the cache, so repeating a pattern over a tree that didn't change doesn't touch the disk
+        inline std::vector<boost::filesystem::path> wildcard(const std::string & pattern, const boost::filesystem::path & base, directory_cache & cache)
+        {
+            return _detail::_wildcard(pattern, base, [&](const boost::filesystem::path & root) { return _detail::_make_cached_source(cache, root); });
+        }
+
+        // the base is already resolved, so unlike the overloads above, these don't need to ask for the working directory on every call
+        inline std::vector<boost::filesystem::path> wildcard(const std::string & pattern, const relative_base & base)
+        {
+            return wildcard(pattern, boost::filesystem::path{ base.path() });
+        }
+
+        inline std::vector<boost::filesystem::path> wildcard(const std::string & pattern, const relative_base & base, directory_cache & cache)
+        {
+            return wildcard(pattern, boost::filesystem::path{ base.path() }, cache);
+        }
+
+        namespace _detail
+        {
+            template<typename F, typename Source>
+            struct _parallel_wildcard_state
+            {
+                _parallel_wildcard_state(F on_match, Source source, std::vector<_wildcard_segment> segments, manual_promise<void> promise)
+                    : on_match{ std::move(on_match) }, source{ std::move(source) }, segments{ std::move(segments) }, promise{ std::move(promise) }
+                {
+                }
+
+                F on_match;
+                std::shared_ptr<executor> sched;
+                Source source;
+                std::vector<_wildcard_segment> segments;
+
+                std::atomic<std::size_t> pending{ 0 };
+                std::atomic<bool> failed{ false };
+                std::mutex exception_lock;
+                std::exception_ptr exception;
+                manual_promise<void> promise;
+            };
+
+            template<typename State>
+            void _parallel_wildcard_spawn(const std::shared_ptr<State> & state, std::string path, std::size_t index);
+
+            // records the exception currently being handled, unless an earlier one was already recorded
+            template<typename State>
+            void _parallel_wildcard_fail(State & state)
+            {
+                std::lock_guard<std::mutex> lock{ state.exception_lock };
+                if (!state.exception)
+                {
+                    state.exception = std::current_exception();
+                    state.failed = true;
+                }
+            }
+
+            // the last task (or the caller, if it finishes after all of the tasks) to release the state fulfills the promise
+            template<typename State>
+            void _parallel_wildcard_release(State & state)
+            {
+                if (state.pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                {
+                    return;
+                }
+
+                if (state.exception)
+                {
+                    state.promise.set(state.exception);
                 }
 
                 else
                 {
-                    for (auto && candidate : last_state)
+                    state.promise.set();
+                }
+            }
+
+            template<typename State>
+            void _parallel_wildcard_visit(const std::shared_ptr<State> & state, std::string & path, std::size_t index, entry_type type)
+            {
+                auto emit = [&](const std::string & path) { state->on_match(boost::filesystem::path{ path }); };
+                auto descend = [&](std::string & path, std::size_t index) { _parallel_wildcard_spawn(state, path, index); };
+                _wildcard_visit(state->source, state->segments, path, index, type, emit, descend);
+            }
+
+            // lists a single directory; subdirectories that need to be listed are handed back to the executor
+            template<typename State>
+            void _parallel_wildcard_expand(const std::shared_ptr<State> & state, std::string & path, std::size_t index, char * buffer)
+            {
+                _wildcard_expand(state->source,
+                    state->segments,
+                    path,
+                    index,
+                    buffer,
+                    [&](std::string & path, std::size_t index, entry_type type) {
+                        if (!state->failed)
+                        {
+                            _parallel_wildcard_visit(state, path, index, type);
+                        }
+                    },
+                    [&](std::string & path, std::size_t index) {
+                        if (!state->failed)
+                        {
+                            _parallel_wildcard_spawn(state, path, index);
+                        }
+                    });
+            }
+
+            template<typename State>
+            void _parallel_wildcard_spawn(const std::shared_ptr<State> & state, std::string path, std::size_t index)
+            {
+                state->pending.fetch_add(1, std::memory_order_relaxed);
+
+                auto task = [state, path = std::move(path), index]() mutable {
+                    // executors are free to run a task inline, so the buffers are picked by how deep the tasks on this thread are nested
+                    thread_local _directory_arena arena;
+                    thread_local std::size_t level = 0;
+
+                    if (!state->failed)
                     {
-                        if (!boost::filesystem::is_directory(base / candidate))
+                        auto buffer = arena.buffer(level++);
+
+                        try
                         {
-                            continue;
+                            _parallel_wildcard_expand(state, path, index, buffer);
                         }
 
-                        for (auto it = boost::filesystem::directory_iterator{ base / std::move(candidate) }; it != end; ++it)
+                        catch (...)
                         {
-                            if (wildcard::match(segment.string(), it->path().filename().string()))
-                            {
-                                state.push_back(make_relative(*it, base));
-                            }
+                            _parallel_wildcard_fail(*state);
                         }
+
+                        --level;
                     }
+
+                    _parallel_wildcard_release(*state);
+                };
+
+                // the task owns the count taken above; if it can't be scheduled, e.g. because the executor is shutting down,
+                // the count is released here, and the error fails the search
+                try
+                {
+                    state->sched->push(std::move(task));
+                }
+
+                catch (...)
+                {
+                    _parallel_wildcard_fail(*state);
+                    _parallel_wildcard_release(*state);
                 }
             }
 
-            return state;
+            template<typename F, typename MakeSource>
+            future<void> _parallel_wildcard(std::shared_ptr<executor> sched,
+                const std::string & pattern,
+                const boost::filesystem::path & base,
+                MakeSource && make_source,
+                F on_match)
+            {
+                using state_type = _parallel_wildcard_state<F, decltype(make_source(std::declval<const boost::filesystem::path &>()))>;
+
+                auto pair = make_promise<void>();
+                std::shared_ptr<state_type> state;
+
+                try
+                {
+                    auto split = _split_pattern(pattern);
+
+                    if (split.segments.empty())
+                    {
+                        on_match(boost::filesystem::path{ split.start });
+                        pair.promise.set();
+                        return std::move(pair.future);
+                    }
+
+                    auto root = split.start.empty() ? base : boost::filesystem::path{ split.start };
+                    if (!boost::filesystem::is_directory(root))
+                    {
+                        pair.promise.set();
+                        return std::move(pair.future);
+                    }
+
+                    state = std::make_shared<state_type>(std::move(on_match), make_source(root), std::move(split.segments), pair.promise);
+                    state->sched = std::move(sched);
+
+                    // the root itself is checked here; the tasks it spawns may all be done before this returns, in which case
+                    // the release below is the last one, and fulfills the promise
+                    state->pending.fetch_add(1, std::memory_order_relaxed);
+                    _parallel_wildcard_visit(state, split.start, 0, entry_type::unknown);
+                }
+
+                catch (...)
+                {
+                    if (!state)
+                    {
+                        pair.promise.set(std::current_exception());
+                        return std::move(pair.future);
+                    }
+
+                    _parallel_wildcard_fail(*state);
+                }
+
+                _parallel_wildcard_release(*state);
+                return std::move(pair.future);
+            }
+        }
+
+        // expands the pattern like wildcard() above, but lists every directory as a separate task on sched, and calls on_match
+        // with every matching path (relative to base) as soon as it's found, instead of collecting them
+        // on_match is called concurrently from the threads of sched, and the order of the matches is unspecified
+        // the returned future is fulfilled once all of the directories have been listed, or with the first error encountered
+        template<typename F>
+        future<void> wildcard(std::shared_ptr<executor> sched, const std::string & pattern, const boost::filesystem::path & base, F on_match)
+        {
+            return _detail::_parallel_wildcard(std::move(sched),
+                pattern,
+                base,
+                [](const boost::filesystem::path & root) { return _detail::_disk_source{ directory{ root.c_str() } }; },
+                std::move(on_match));
+        }
+
+        template<typename F>
+        future<void> wildcard(std::shared_ptr<executor> sched, const std::string & pattern, const boost::filesystem::path & base, directory_cache & cache, F on_match)
+        {
+            return _detail::_parallel_wildcard(std::move(sched),
+                pattern,
+                base,
+                [&](const boost::filesystem::path & root) { return _detail::_make_cached_source(cache, root); },
+                std::move(on_match));
         }
 
         inline std::vector<boost::filesystem::path> all_symlinked_paths(boost::filesystem::path path)
@@ -154,6 +721,18 @@ namespace filesystem
 
             return ret;
         }
+
+        // same as above, but every path is made relative to base
+        inline std::vector<boost::filesystem::path> all_symlinked_paths(const boost::filesystem::path & path, const relative_base & base)
+        {
+            auto ret = all_symlinked_paths(path);
+            for (auto && element : ret)
+            {
+                element = make_relative(element, base);
+            }
+
+            return ret;
+        }
     }
 }
 }
@@ -0,0 +1,286 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+namespace reaver
+{
+namespace filesystem
+{
+    inline namespace _v1
+    {
+        enum class entry_type
+        {
+            unknown,
+            regular,
+            directory,
+            symlink,
+            other
+        };
+
+        namespace _detail
+        {
+            [[noreturn]] inline void _throw_filesystem_error(const char * what, const std::string & path)
+            {
+                throw boost::filesystem::filesystem_error{ what, path, boost::system::error_code{ errno, boost::system::system_category() } };
+            }
+
+            inline entry_type _entry_type(unsigned char d_type)
+            {
+                switch (d_type)
+                {
+                    case DT_REG:
+                        return entry_type::regular;
+                    case DT_DIR:
+                        return entry_type::directory;
+                    case DT_LNK:
+                        return entry_type::symlink;
+                    case DT_UNKNOWN:
+                        return entry_type::unknown;
+                    default:
+                        return entry_type::other;
+                }
+            }
+
+            inline entry_type _stat_type(int dirfd, const char * name, bool follow)
+            {
+                struct stat info;
+                if (::fstatat(dirfd, name, &info, follow ? 0 : AT_SYMLINK_NOFOLLOW) < 0)
+                {
+                    return entry_type::unknown;
+                }
+
+                return S_ISREG(info.st_mode) ? entry_type::regular
+                                             : S_ISDIR(info.st_mode) ? entry_type::directory : S_ISLNK(info.st_mode) ? entry_type::symlink : entry_type::other;
+            }
+
+            // whether the entry is a directory, following symlinks; only stats the entries that d_type didn't tell enough about
+            inline bool _is_directory(int dirfd, const char * name, entry_type type)
+            {
+                switch (type)
+                {
+                    case entry_type::directory:
+                        return true;
+                    case entry_type::symlink:
+                    case entry_type::unknown:
+                        return _stat_type(dirfd, name, true) == entry_type::directory;
+                    default:
+                        return false;
+                }
+            }
+
+            inline void _append_name(std::string & path, std::string_view name)
+            {
+                if (!path.empty() && path.back() != '/')
+                {
+                    path.push_back('/');
+                }
+
+                path.append(name);
+            }
+
+            inline const char * _relative_name(const std::string & path)
+            {
+                return path.empty() ? "." : path.c_str();
+            }
+
+            // buffers for getdents64, one per nesting level, reused for every directory listed at that level
+            class _directory_arena
+            {
+            public:
+                static constexpr std::size_t buffer_size = 32 * 1024;
+
+                char * buffer(std::size_t level)
+                {
+                    while (_buffers.size() <= level)
+                    {
+                        _buffers.push_back(std::make_unique<char[]>(buffer_size));
+                    }
+
+                    return _buffers[level].get();
+                }
+
+            private:
+                std::vector<std::unique_ptr<char[]>> _buffers;
+            };
+        }
+
+        // an open directory, read with getdents64; entries are reported with the type from d_type, without a stat per entry
+        class directory
+        {
+        public:
+            directory(const char * path) : directory{ AT_FDCWD, path }
+            {
+            }
+
+            directory(int dirfd, const char * path) : directory{ dirfd, path, path }
+            {
+            }
+
+            // opens name relative to parent; errors name the path of parent joined with name
+            directory(const directory & parent, const char * name) : directory{ parent._fd, name, parent._path + '/' + name }
+            {
+            }
+
+            directory(const directory &) = delete;
+            directory & operator=(const directory &) = delete;
+
+            directory(directory && other) noexcept : _fd{ std::exchange(other._fd, -1) }, _path{ std::move(other._path) }
+            {
+            }
+
+            ~directory()
+            {
+                if (_fd >= 0)
+                {
+                    ::close(_fd);
+                }
+            }
+
+            int fd() const
+            {
+                return _fd;
+            }
+
+            // calls f(name, type) for every entry other than `.` and `..`; names point into buffer, and are only valid during the call
+            // buffer must be at least _directory_arena::buffer_size bytes
+            template<typename F>
+            void for_each(char * buffer, F && f) const
+            {
+                while (true)
+                {
+                    auto size = ::syscall(SYS_getdents64, _fd, buffer, _detail::_directory_arena::buffer_size);
+                    if (size < 0)
+                    {
+                        _detail::_throw_filesystem_error("failed to read a directory", _path);
+                    }
+
+                    if (size == 0)
+                    {
+                        return;
+                    }
+
+                    for (long position = 0; position < size;)
+                    {
+                        auto entry = reinterpret_cast<const _dirent64 *>(buffer + position);
+                        position += entry->d_reclen;
+
+                        auto name = entry->d_name;
+                        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+                        {
+                            continue;
+                        }
+
+                        f(std::string_view{ name }, _detail::_entry_type(entry->d_type));
+                    }
+                }
+            }
+
+            const std::string & path() const
+            {
+                return _path;
+            }
+
+        private:
+            directory(int dirfd, const char * name, std::string path)
+                : _fd{ ::openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC) }, _path{ std::move(path) }
+            {
+                if (_fd < 0)
+                {
+                    _detail::_throw_filesystem_error("failed to open a directory", _path);
+                }
+            }
+
+            struct _dirent64
+            {
+                std::uint64_t d_ino;
+                std::int64_t d_off;
+                unsigned short d_reclen;
+                unsigned char d_type;
+                char d_name[1];
+            };
+
+            int _fd;
+            std::string _path;
+        };
+
+        namespace _detail
+        {
+            template<typename F>
+            void _walk(const directory & dir, std::string & path, std::size_t level, _directory_arena & arena, F & on_entry)
+            {
+                dir.for_each(arena.buffer(level), [&](std::string_view name, entry_type type) {
+                    auto length = path.size();
+                    if (length)
+                    {
+                        path.push_back('/');
+                    }
+                    path.append(name);
+
+                    if (type == entry_type::unknown)
+                    {
+                        type = _stat_type(dir.fd(), path.c_str() + path.size() - name.size(), false);
+                    }
+
+                    if (on_entry(std::string_view{ path }, type) && type == entry_type::directory)
+                    {
+                        directory child{ dir, path.c_str() + path.size() - name.size() };
+                        _walk(child, path, level + 1, arena, on_entry);
+                    }
+
+                    path.resize(length);
+                });
+            }
+        }
+
+        // walks the tree under root depth-first, calling on_entry(path, type) for every entry, where path is relative to root
+        // on_entry returns whether to descend into the entry, if it's a directory; symlinks to directories are not followed
+        // the path is only valid during the call; directories are opened relative to their parent, and nothing is allocated per entry
+        template<typename F>
+        void walk(const boost::filesystem::path & root, F && on_entry)
+        {
+            directory dir{ root.c_str() };
+            std::string path;
+            _detail::_directory_arena arena;
+            _detail::_walk(dir, path, 0, arena, on_entry);
+        }
+    }
+}
+}
@@ -0,0 +1,381 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "directory.h"
+
+namespace reaver
+{
+namespace filesystem
+{
+    inline namespace _v1
+    {
+        // the entries of a single directory, as they were when it was listed; the names are stored back to back in a single string
+        class directory_listing
+        {
+        public:
+            // calls f(name, type) for every entry, in the order of names
+            template<typename F>
+            void for_each(F && f) const
+            {
+                for (auto && entry : _entries)
+                {
+                    f(_name(entry), entry.type);
+                }
+            }
+
+            // returns entry_type::unknown if there is no such entry
+            entry_type find(std::string_view name) const
+            {
+                auto it = std::lower_bound(_entries.begin(), _entries.end(), name, [&](const _entry & entry, std::string_view name) { return _name(entry) < name; });
+                return it != _entries.end() && _name(*it) == name ? it->type : entry_type::unknown;
+            }
+
+            std::size_t size() const
+            {
+                return _entries.size();
+            }
+
+        private:
+            friend class directory_cache;
+
+            struct _entry
+            {
+                std::uint32_t offset;
+                std::uint32_t size;
+                entry_type type;
+            };
+
+            std::string_view _name(const _entry & entry) const
+            {
+                return std::string_view{ _names }.substr(entry.offset, entry.size);
+            }
+
+            std::string _names;
+            std::vector<_entry> _entries;
+        };
+
+        // an in-memory copy of directory listings, kept up to date with inotify
+        // a directory is read from the disk the first time it's listed, and is watched from then on; any change to it drops it from the cache,
+        // together with everything cached below it, and the next list() reads it again
+        // changes are only picked up by refresh(), so that listing a cached directory doesn't need a single system call
+        // a watch is removed once nothing cached depends on it anymore; when no more watches can be added, directories are still listed,
+        // just not cached
+        // paths are used as they are given, so the same directory reached through two different paths is cached twice
+        class directory_cache
+        {
+        public:
+            directory_cache() : _fd{ ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC) }
+            {
+                if (_fd < 0)
+                {
+                    _detail::_throw_filesystem_error("failed to initialize inotify", {});
+                }
+            }
+
+            directory_cache(const directory_cache &) = delete;
+            directory_cache & operator=(const directory_cache &) = delete;
+
+            ~directory_cache()
+            {
+                ::close(_fd);
+            }
+
+            // applies the changes that inotify reported since the last call
+            void refresh()
+            {
+                std::lock_guard<std::mutex> lock{ _lock };
+
+                alignas(inotify_event) char buffer[16 * 1024];
+                while (true)
+                {
+                    auto size = ::read(_fd, buffer, sizeof(buffer));
+                    if (size <= 0)
+                    {
+                        return;
+                    }
+
+                    for (long position = 0; position < size;)
+                    {
+                        auto event = reinterpret_cast<const inotify_event *>(buffer + position);
+                        position += sizeof(inotify_event) + event->len;
+
+                        _handle(*event);
+                    }
+                }
+            }
+
+            // lists the directory at path, or returns the copy from the last time it was listed, if nothing changed since
+            // the types of entries are always known; entries the filesystem didn't give a type for are stat'd when the directory is read
+            std::shared_ptr<const directory_listing> list(const std::string & path)
+            {
+                std::uint64_t epoch = 0;
+                int watch;
+
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+
+                    auto it = _listings.find(path);
+                    if (it != _listings.end())
+                    {
+                        return it->second.listing;
+                    }
+
+                    // the watch goes first, so that a change made while the directory is being read is reported
+                    watch = ::inotify_add_watch(_fd, path.c_str(), _watched_events);
+                    if (watch >= 0)
+                    {
+                        auto & paths = _watches[watch];
+                        if (std::find(paths.begin(), paths.end(), path) == paths.end())
+                        {
+                            paths.push_back(path);
+                        }
+
+                        epoch = _epoch;
+                    }
+                }
+
+                // usually the limit of watches was reached; if the directory can't be read either, _read() reports that
+                if (watch < 0)
+                {
+                    return _read(path);
+                }
+
+                std::shared_ptr<const directory_listing> listing;
+
+                try
+                {
+                    listing = _read(path);
+                }
+
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+                    _release(watch);
+                    throw;
+                }
+
+                // if anything was dropped while this was being read, this listing may already be out of date, so it's not kept
+                std::lock_guard<std::mutex> lock{ _lock };
+                if (epoch == _epoch)
+                {
+                    _listings.emplace(path, _cached{ listing, watch });
+                }
+
+                else
+                {
+                    _release(watch);
+                }
+
+                return listing;
+            }
+
+            // drops every cached listing
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock{ _lock };
+                _clear();
+            }
+
+        private:
+            static constexpr std::uint32_t _watched_events = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+            static std::shared_ptr<const directory_listing> _read(const std::string & path)
+            {
+                thread_local _detail::_directory_arena arena;
+
+                auto listing = std::make_shared<directory_listing>();
+                directory dir{ path.c_str() };
+
+                dir.for_each(arena.buffer(0), [&](std::string_view name, entry_type type) {
+                    // names come from a getdents64 record, so they are null-terminated
+                    if (type == entry_type::unknown)
+                    {
+                        type = _detail::_stat_type(dir.fd(), name.data(), false);
+                    }
+
+                    listing->_entries.push_back({ static_cast<std::uint32_t>(listing->_names.size()), static_cast<std::uint32_t>(name.size()), type });
+                    listing->_names.append(name);
+                });
+
+                std::sort(listing->_entries.begin(), listing->_entries.end(), [&](auto && lhs, auto && rhs) {
+                    return listing->_name(lhs) < listing->_name(rhs);
+                });
+
+                return listing;
+            }
+
+            void _handle(const inotify_event & event)
+            {
+                if (event.mask & IN_Q_OVERFLOW)
+                {
+                    _clear();
+                    return;
+                }
+
+                auto it = _watches.find(event.wd);
+                if (it == _watches.end())
+                {
+                    return;
+                }
+
+                // the kernel removes watches of deleted directories by itself; moved directories aren't at the watched paths anymore
+                if (event.mask & IN_MOVE_SELF)
+                {
+                    ::inotify_rm_watch(_fd, event.wd);
+                }
+
+                // copied, since dropping listings can remove watches
+                auto paths = it->second;
+                if (event.mask & (IN_IGNORED | IN_MOVE_SELF))
+                {
+                    _watches.erase(it);
+                }
+
+                std::vector<int> dropped;
+
+                for (auto && path : paths)
+                {
+                    if (event.len)
+                    {
+                        // the directory itself changed, and whatever was cached under the entry is gone, or isn't what it used to be
+                        _drop(path, false, dropped);
+
+                        auto child = path;
+                        _detail::_append_name(child, event.name);
+                        _drop(child, true, dropped);
+                    }
+
+                    else
+                    {
+                        _drop(path, true, dropped);
+                    }
+                }
+
+                for (auto watch : dropped)
+                {
+                    _release(watch);
+                }
+            }
+
+            // erases the listings, and collects the watches they were cached under, to be released once everything is dropped
+            void _drop(const std::string & path, bool subtree, std::vector<int> & watches)
+            {
+                ++_epoch;
+
+                auto erase = [&](auto it) {
+                    watches.push_back(it->second.watch);
+                    return _listings.erase(it);
+                };
+
+                auto it = _listings.find(path);
+                if (it != _listings.end())
+                {
+                    erase(it);
+                }
+
+                if (!subtree)
+                {
+                    return;
+                }
+
+                auto prefix = path;
+                if (prefix.empty() || prefix.back() != '/')
+                {
+                    prefix.push_back('/');
+                }
+
+                it = _listings.lower_bound(prefix);
+                while (it != _listings.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+                {
+                    it = erase(it);
+                }
+            }
+
+            // removes the watch if none of its paths is cached under it anymore
+            // a list() of one of them may be in progress; the epoch changes, so that it doesn't cache what the removed watch was for
+            void _release(int watch)
+            {
+                auto it = _watches.find(watch);
+                if (it == _watches.end())
+                {
+                    return;
+                }
+
+                for (auto && path : it->second)
+                {
+                    auto listing = _listings.find(path);
+                    if (listing != _listings.end() && listing->second.watch == watch)
+                    {
+                        return;
+                    }
+                }
+
+                ::inotify_rm_watch(_fd, watch);
+                _watches.erase(it);
+                ++_epoch;
+            }
+
+            void _clear()
+            {
+                for (auto && watch : _watches)
+                {
+                    ::inotify_rm_watch(_fd, watch.first);
+                }
+
+                _watches.clear();
+                _listings.clear();
+                ++_epoch;
+            }
+
+            struct _cached
+            {
+                std::shared_ptr<const directory_listing> listing;
+                int watch;
+            };
+
+            int _fd;
+
+            std::mutex _lock;
+            std::map<std::string, _cached> _listings;
+            std::unordered_map<int, std::vector<std::string>> _watches;
+            std::uint64_t _epoch = 0;
+        };
+    }
+}
+}
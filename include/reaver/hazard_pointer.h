@@ -0,0 +1,182 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace reaver
+{
+inline namespace _v1
+{
+    namespace _detail
+    {
+        struct _hazard_record
+        {
+            std::atomic<const void *> pointer{ nullptr };
+            std::atomic<bool> active{ false };
+            _hazard_record * next = nullptr;
+        };
+
+        // records are never freed; there are only ever as many of them as there were hazard pointers alive at the same time
+        inline std::atomic<_hazard_record *> & _hazard_records()
+        {
+            static std::atomic<_hazard_record *> head{ nullptr };
+            return head;
+        }
+
+        inline _hazard_record * _acquire_hazard_record()
+        {
+            thread_local _hazard_record * hint = nullptr;
+
+            auto try_acquire = [](_hazard_record * record) {
+                bool expected = false;
+                return !record->active.load(std::memory_order_relaxed) && record->active.compare_exchange_strong(expected, true, std::memory_order_acquire);
+            };
+
+            if (hint && try_acquire(hint))
+            {
+                return hint;
+            }
+
+            for (auto record = _hazard_records().load(std::memory_order_acquire); record; record = record->next)
+            {
+                if (try_acquire(record))
+                {
+                    hint = record;
+                    return record;
+                }
+            }
+
+            auto record = new _hazard_record;
+            record->active.store(true, std::memory_order_relaxed);
+
+            auto head = _hazard_records().load(std::memory_order_relaxed);
+            do
+            {
+                record->next = head;
+            } while (!_hazard_records().compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+
+            hint = record;
+            return record;
+        }
+    }
+
+    // marks a single pointer as being in use by the current thread, so that retire_if_unused() won't delete it
+    class hazard_pointer
+    {
+    public:
+        hazard_pointer() : _record{ _detail::_acquire_hazard_record() }
+        {
+        }
+
+        hazard_pointer(const hazard_pointer &) = delete;
+        hazard_pointer & operator=(const hazard_pointer &) = delete;
+
+        hazard_pointer(hazard_pointer && other) noexcept : _record{ std::exchange(other._record, nullptr) }
+        {
+        }
+
+        hazard_pointer & operator=(hazard_pointer && other) noexcept
+        {
+            _release();
+            _record = std::exchange(other._record, nullptr);
+            return *this;
+        }
+
+        ~hazard_pointer()
+        {
+            _release();
+        }
+
+        // loads the pointer from source and protects it; the returned pointer stays valid until reset() or destruction
+        template<typename T>
+        T * protect(const std::atomic<T *> & source)
+        {
+            auto pointer = source.load(std::memory_order_relaxed);
+
+            while (true)
+            {
+                _record->pointer.store(pointer);
+
+                // the pointer could have been retired between the load and the store above
+                auto current = source.load();
+                if (current == pointer)
+                {
+                    return pointer;
+                }
+
+                pointer = current;
+            }
+        }
+
+        void reset()
+        {
+            _record->pointer.store(nullptr, std::memory_order_release);
+        }
+
+    private:
+        void _release()
+        {
+            if (_record)
+            {
+                _record->pointer.store(nullptr, std::memory_order_release);
+                _record->active.store(false, std::memory_order_release);
+                _record = nullptr;
+            }
+        }
+
+        _detail::_hazard_record * _record;
+    };
+
+    // deletes the pointers in retired that aren't protected by any hazard pointer, and removes them from the list
+    // the pointers must already be unreachable for new readers, i.e. removed from every atomic a hazard pointer could load them from
+    template<typename T>
+    void retire_if_unused(std::vector<T *> & retired)
+    {
+        if (retired.empty())
+        {
+            return;
+        }
+
+        std::vector<const void *> hazards;
+        for (auto record = _detail::_hazard_records().load(std::memory_order_acquire); record; record = record->next)
+        {
+            if (auto pointer = record->pointer.load())
+            {
+                hazards.push_back(pointer);
+            }
+        }
+
+        std::sort(hazards.begin(), hazards.end());
+
+        auto unused = std::stable_partition(
+            retired.begin(), retired.end(), [&](T * pointer) { return std::binary_search(hazards.begin(), hazards.end(), static_cast<const void *>(pointer)); });
+
+        std::for_each(unused, retired.end(), [](T * pointer) { delete pointer; });
+        retired.erase(unused, retired.end());
+    }
+}
+}
@@ -25,7 +25,7 @@
 #include <atomic>
 #include <vector>
 
-#include "../style.h"
+#include "call_site.h"
 #include "level_registry.h"
 #include "logger_friend.h"
 #include "streamable.h"
@@ -42,7 +42,6 @@ namespace logger
         public:
             action(logger & log = reaver::logger::default_logger()) : _logger(log), _streamables()
             {
-                _streamables.emplace_back(style::style());
             }
 
             ~action()
@@ -52,14 +51,42 @@ namespace logger
                     return;
                 }
 
-                _streamables.emplace_back(static_cast<std::ostream & (*)(std::ostream &)>(&std::endl));
-                logger_friend::_write(_logger, _streamables);
+                if (!_suppressed)
+                {
+                    _streamables.emplace_back(static_cast<std::ostream & (*)(std::ostream &)>(&std::endl));
+                    logger_friend::_write(_logger, Level{}, std::move(_streamables));
+                }
+
+                if (!_site)
+                {
+                    return;
+                }
+
+                if (auto suppressed = _site->take_suppressed(_suppressed))
+                {
+                    std::vector<streamable> summary;
+                    summary.emplace_back("suppressed ");
+                    summary.emplace_back(suppressed);
+                    summary.emplace_back(" messages");
+                    if (_site->file())
+                    {
+                        summary.emplace_back(" from ");
+                        summary.emplace_back(_site->file());
+                        summary.emplace_back(':');
+                        summary.emplace_back(_site->line());
+                    }
+                    summary.emplace_back(static_cast<std::ostream & (*)(std::ostream &)>(&std::endl));
+                    logger_friend::_write(_logger, Level{}, std::move(summary));
+                }
             }
 
             template<typename T>
             action & operator<<(T && rhs)
             {
-                _streamables.emplace_back(std::forward<T>(rhs));
+                if (!_suppressed)
+                {
+                    _streamables.emplace_back(std::forward<T>(rhs));
+                }
                 return *this;
             }
 
@@ -72,12 +99,18 @@ namespace logger
             friend class logger;
 
         private:
-            action(logger & log, std::vector<streamable> vec) : _logger{ log }
+            action(logger & log, call_site * site) : _logger{ log }, _site{ site }
+            {
+            }
+
+            // a record dropped by its call site; streaming into it is a no-op
+            action(logger & log, call_site & site, bool suppressed) : _logger{ log }, _site{ &site }, _suppressed{ suppressed }
             {
-                _streamables.swap(vec);
             }
 
             logger & _logger;
+            call_site * _site = nullptr;
+            bool _suppressed = false;
 
             std::vector<streamable> _streamables;
         };
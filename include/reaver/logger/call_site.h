@@ -0,0 +1,252 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "../swallow.h"
+#include "../unit.h"
+
+namespace reaver
+{
+namespace logger
+{
+    inline namespace _v1
+    {
+        // at most `per_second` records per second, with bursts of up to `burst` records
+        struct rate_limit
+        {
+            double per_second;
+            std::size_t burst = 1;
+        };
+
+        // every record is kept with the given probability
+        struct sampling
+        {
+            double probability;
+        };
+
+        // minimal time between two "suppressed N messages" summaries of a single call site
+        struct summary_interval
+        {
+            std::chrono::steady_clock::duration interval;
+        };
+
+        struct location
+        {
+            const char * file;
+            std::size_t line;
+        };
+
+        // the state of a single logging call site; meant to be a static object, see REAVER_LOG_SITE
+        // all of the checks are a handful of relaxed atomic operations, so that a suppressed record
+        // costs next to nothing, and in particular doesn't reach the logger at all
+        class call_site
+        {
+        public:
+            template<typename... Args>
+            call_site(Args &&... args)
+            {
+                swallow{ _initialize(std::forward<Args>(args))... };
+            }
+
+            call_site(const call_site &) = delete;
+            call_site & operator=(const call_site &) = delete;
+
+            bool admit()
+            {
+                if (_sampling_threshold < _always && _draw() >= _sampling_threshold)
+                {
+                    _suppress();
+                    return false;
+                }
+
+                if (!_emission_interval)
+                {
+                    return true;
+                }
+
+                // generic cell rate algorithm: a token bucket expressed as a single timestamp
+                auto now = _now();
+                auto tat = _theoretical_arrival.load(std::memory_order_relaxed);
+                std::int64_t next;
+
+                do
+                {
+                    auto base = std::max(tat, now);
+                    if (base - now > _tolerance)
+                    {
+                        _suppress();
+                        return false;
+                    }
+
+                    next = base + _emission_interval;
+                } while (!_theoretical_arrival.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+
+                return true;
+            }
+
+            // returns the number of records suppressed since the last summary, if a new summary is due;
+            // zero otherwise
+            // after an admitted record, a summary is due once summary_interval has passed since the previous one; after a suppressed
+            // record (dropped == true), the oldest suppression it would report also has to be at least summary_interval old, so that
+            // a site that is always suppressed still reports periodically, but not on every call
+            // summaries are only checked for when the site is reached, so the last count of a site that stops being reached is
+            // only reported if it's reached again
+            std::size_t take_suppressed(bool dropped = false)
+            {
+                if (!_suppressed.load(std::memory_order_relaxed))
+                {
+                    return 0;
+                }
+
+                auto now = _now();
+                if (dropped)
+                {
+                    auto since = _pending_since.load(std::memory_order_relaxed);
+                    if (!since || now - since < _summary_interval)
+                    {
+                        return 0;
+                    }
+                }
+
+                auto next = _next_summary.load(std::memory_order_relaxed);
+                if (now < next || !_next_summary.compare_exchange_strong(next, now + _summary_interval, std::memory_order_relaxed))
+                {
+                    return 0;
+                }
+
+                _pending_since.store(0, std::memory_order_relaxed);
+                return _suppressed.exchange(0, std::memory_order_relaxed);
+            }
+
+            const char * file() const
+            {
+                return _file;
+            }
+
+            std::size_t line() const
+            {
+                return _line;
+            }
+
+        private:
+            // a rate that isn't positive (or is NaN) admits nothing; tiny rates and huge bursts saturate instead of overflowing
+            unit _initialize(rate_limit limit)
+            {
+                if (!(limit.per_second > 0))
+                {
+                    _sampling_threshold = 0;
+                    return {};
+                }
+
+                auto interval = 1'000'000'000 / limit.per_second;
+                _emission_interval = interval < _max_interval ? static_cast<std::int64_t>(interval) : _max_interval;
+
+                auto burst = limit.burst ? limit.burst - 1 : 0;
+                _tolerance = _emission_interval && burst > static_cast<std::size_t>(_max_interval / _emission_interval)
+                    ? _max_interval
+                    : _emission_interval * static_cast<std::int64_t>(burst);
+                return {};
+            }
+
+            unit _initialize(sampling s)
+            {
+                _sampling_threshold = s.probability >= 1 ? _always : s.probability <= 0 ? 0 : static_cast<std::uint64_t>(s.probability * _always);
+                return {};
+            }
+
+            unit _initialize(summary_interval i)
+            {
+                _summary_interval = std::chrono::duration_cast<std::chrono::nanoseconds>(i.interval).count();
+                return {};
+            }
+
+            unit _initialize(location loc)
+            {
+                _file = loc.file;
+                _line = loc.line;
+                return {};
+            }
+
+            void _suppress()
+            {
+                _suppressed.fetch_add(1, std::memory_order_relaxed);
+
+                // only the first suppression after a summary reads the clock
+                if (!_pending_since.load(std::memory_order_relaxed))
+                {
+                    std::int64_t expected = 0;
+                    _pending_since.compare_exchange_strong(expected, _now(), std::memory_order_relaxed);
+                }
+            }
+
+            static std::int64_t _now()
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            static std::uint64_t _draw()
+            {
+                // xorshift; doesn't need to be good, just cheap and per-thread
+                thread_local std::uint64_t state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                return state >> 32;
+            }
+
+            static constexpr std::uint64_t _always = std::uint64_t{ 1 } << 32;
+
+            // the theoretical arrival time stays below now + tolerance + interval, so this keeps all of the arithmetic in range
+            static constexpr std::int64_t _max_interval = std::numeric_limits<std::int64_t>::max() / 8;
+
+            std::uint64_t _sampling_threshold = _always;
+            std::int64_t _emission_interval = 0;
+            std::int64_t _tolerance = 0;
+            std::int64_t _summary_interval = 1'000'000'000;
+
+            const char * _file = nullptr;
+            std::size_t _line = 0;
+
+            std::atomic<std::int64_t> _theoretical_arrival{ 0 };
+            std::atomic<std::int64_t> _next_summary{ 0 };
+            std::atomic<std::size_t> _suppressed{ 0 };
+            std::atomic<std::int64_t> _pending_since{ 0 };
+        };
+    }
+}
+}
+
+// creates a call site object that is unique to the place where the macro is expanded
+// usage: dlog(error, REAVER_LOG_SITE(reaver::logger::rate_limit{ 10, 100 })) << ...;
+#define REAVER_LOG_SITE(...)                                                                                                                                   \
+    ([]() -> ::reaver::logger::call_site & {                                                                                                                   \
+        static ::reaver::logger::call_site site{ ::reaver::logger::location{ __FILE__, __LINE__ }, __VA_ARGS__ };                                              \
+        return site;                                                                                                                                           \
+    }())
@@ -0,0 +1,196 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <exception>
+#include <memory>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "../once.h"
+#include "crash_buffer.h"
+
+namespace reaver
+{
+namespace logger
+{
+    inline namespace _v1
+    {
+        // writes out the records of every logger with enable_crash_flush() that haven't reached their streams yet
+        // async-signal-safe; doesn't take any locks and doesn't allocate
+        inline void emergency_flush() noexcept
+        {
+            auto saved_errno = errno;
+
+            for (auto & slot : _detail::_crash_buffers())
+            {
+                auto buffer = slot.load(std::memory_order_acquire);
+                if (!buffer)
+                {
+                    continue;
+                }
+
+                buffer->drain([](int fd, const char * data, std::size_t size) {
+                    while (size)
+                    {
+                        auto written = ::write(fd, data, size);
+                        if (written < 0)
+                        {
+                            if (errno == EINTR)
+                            {
+                                continue;
+                            }
+
+                            return;
+                        }
+
+                        data += written;
+                        size -= written;
+                    }
+                });
+            }
+
+            errno = saved_errno;
+        }
+
+        namespace _detail
+        {
+            constexpr int _crash_signals[] = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL };
+            constexpr std::size_t _crash_signal_count = sizeof(_crash_signals) / sizeof(*_crash_signals);
+
+            inline struct sigaction (&_previous_actions())[_crash_signal_count]
+            {
+                static struct sigaction actions[_crash_signal_count];
+                return actions;
+            }
+
+            inline std::terminate_handler & _previous_terminate()
+            {
+                static std::terminate_handler handler = nullptr;
+                return handler;
+            }
+
+            inline void _crash_signal_handler(int signal)
+            {
+                emergency_flush();
+
+                // give the signal to whoever was handling it before, or let it kill the process
+                for (std::size_t i = 0; i < _crash_signal_count; ++i)
+                {
+                    if (_crash_signals[i] == signal)
+                    {
+                        ::sigaction(signal, &_previous_actions()[i], nullptr);
+                        break;
+                    }
+                }
+
+                ::raise(signal);
+            }
+
+            // an alternate signal stack for the current thread, so that the handlers can run when the thread overflowed its stack
+            // removed and freed when the thread exits; a stack installed by someone else is left alone
+            class _crash_signal_stack
+            {
+            public:
+                _crash_signal_stack()
+                {
+                    stack_t current;
+                    if (::sigaltstack(nullptr, &current) != 0 || !(current.ss_flags & SS_DISABLE))
+                    {
+                        return;
+                    }
+
+                    auto size = std::max<std::size_t>(SIGSTKSZ, 64 * 1024);
+                    _memory.reset(new char[size]);
+
+                    stack_t stack = {};
+                    stack.ss_sp = _memory.get();
+                    stack.ss_size = size;
+                    if (::sigaltstack(&stack, nullptr) != 0)
+                    {
+                        _memory.reset();
+                    }
+                }
+
+                ~_crash_signal_stack()
+                {
+                    if (_memory)
+                    {
+                        stack_t stack = {};
+                        stack.ss_flags = SS_DISABLE;
+                        ::sigaltstack(&stack, nullptr);
+                    }
+                }
+
+            private:
+                std::unique_ptr<char[]> _memory;
+            };
+
+            inline void _crash_terminate_handler()
+            {
+                emergency_flush();
+
+                if (auto previous = _previous_terminate())
+                {
+                    previous();
+                }
+
+                std::abort();
+            }
+        }
+
+        // gives the calling thread an alternate signal stack, so that the crash handlers still run when it overflows its stack
+        // signal stacks belong to threads; install_crash_handlers() sets one up for the thread it's called on, and other threads
+        // that should be covered call this when they start
+        inline void install_crash_signal_stack()
+        {
+            static thread_local _detail::_crash_signal_stack stack;
+        }
+
+        // installs handlers for SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL and std::terminate that call emergency_flush()
+        // and then defer to the handlers that were installed before; installing them more than once does nothing
+        inline void install_crash_handlers()
+        {
+            install_crash_signal_stack();
+
+            once([] {
+                struct sigaction action = {};
+                action.sa_handler = &_detail::_crash_signal_handler;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_ONSTACK;
+
+                for (std::size_t i = 0; i < _detail::_crash_signal_count; ++i)
+                {
+                    ::sigaction(_detail::_crash_signals[i], &action, &_detail::_previous_actions()[i]);
+                }
+
+                _detail::_previous_terminate() = std::set_terminate(&_detail::_crash_terminate_handler);
+            });
+        }
+    }
+}
+}
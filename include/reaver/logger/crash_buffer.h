@@ -0,0 +1,276 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "level_registry.h"
+#include "stream_wrapper.h"
+#include "streamable.h"
+
+namespace reaver
+{
+namespace logger
+{
+    inline namespace _v1
+    {
+        namespace _detail
+        {
+            // a copy of the records that haven't been flushed to their streams yet, already rendered to bytes
+            // and stored in memory allocated up front, so that they can be written out from a signal handler
+            // only streams with a known file descriptor take part in this; see stream_wrapper::fd()
+            // the slots form a ring; once more records are waiting than there are slots, a new record overwrites the oldest one,
+            // and if that one is still being written by another thread, the new record isn't kept here at all
+            // (it's still logged normally; it just won't be written out if the process crashes before that)
+            class _crash_buffer
+            {
+            public:
+                static constexpr std::size_t max_streams = 32;
+                static constexpr std::size_t slot_size = 512;
+
+                _crash_buffer(std::size_t slots) : _slots{ new _slot[slots] }, _slot_count{ slots }
+                {
+                    for (auto & fd : _fds)
+                    {
+                        fd = -1;
+                    }
+
+                    for (std::size_t i = 0; i < level_count; ++i)
+                    {
+                        auto & buffer = _render_buffer();
+                        buffer.str().clear();
+
+                        for (const auto & x : default_level_registry()[static_cast<base_level>(i)])
+                        {
+                            x.stream(_render_wrapper());
+                        }
+
+                        _prefixes[i] = buffer.str();
+                    }
+                }
+
+                // returns the index of the stream, or -1 if there is no more room for streams
+                int add_stream(int fd)
+                {
+                    for (std::size_t i = 0; i < max_streams; ++i)
+                    {
+                        int expected = -1;
+                        if (_fds[i].compare_exchange_strong(expected, fd))
+                        {
+                            _streams.fetch_or(std::uint32_t{ 1 } << i);
+                            return static_cast<int>(i);
+                        }
+                    }
+
+                    return -1;
+                }
+
+                bool has_streams() const
+                {
+                    return _streams.load(std::memory_order_relaxed);
+                }
+
+                // returns a ticket identifying the record, to be passed to release() once the record is flushed
+                // returns 0 if the record wasn't kept, because its slot was still being written by another thread
+                std::uint64_t publish(base_level level, const std::vector<streamable> & streamables)
+                {
+                    auto & buffer = _render_buffer();
+                    buffer.str().clear();
+
+                    for (const auto & x : streamables)
+                    {
+                        x.stream(_render_wrapper());
+                    }
+
+                    const auto & prefix = _prefixes[static_cast<std::size_t>(level)];
+                    const auto & body = buffer.str();
+
+                    auto ticket = _head.fetch_add(1, std::memory_order_relaxed) + 1;
+                    auto & slot = _slots[ticket % _slot_count];
+
+                    // only a single writer at a time may own a slot; if the slot is being written, or a newer record already took it, give up
+                    auto previous = slot.sequence.load(std::memory_order_relaxed);
+                    do
+                    {
+                        if (previous == _writing || previous > ticket)
+                        {
+                            return 0;
+                        }
+                    } while (!slot.sequence.compare_exchange_weak(previous, _writing, std::memory_order_acquire, std::memory_order_relaxed));
+
+                    // drain() must not see any of the writes below before it sees the slot being claimed
+                    std::atomic_thread_fence(std::memory_order_release);
+
+                    auto prefix_size = std::min(prefix.size(), slot_size);
+                    auto body_size = std::min(body.size(), slot_size - prefix_size);
+                    std::memcpy(slot.data, prefix.data(), prefix_size);
+                    std::memcpy(slot.data + prefix_size, body.data(), body_size);
+                    slot.size = prefix_size + body_size;
+
+                    // truncated records still end their line
+                    if (body_size < body.size())
+                    {
+                        slot.data[slot.size - 1] = '\n';
+                    }
+
+                    slot.mask.store(_streams.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    slot.sequence.store(ticket, std::memory_order_release);
+
+                    return ticket;
+                }
+
+                void release(std::uint64_t ticket, int stream)
+                {
+                    if (!ticket)
+                    {
+                        return;
+                    }
+
+                    auto & slot = _slots[ticket % _slot_count];
+                    if (slot.sequence.load(std::memory_order_acquire) == ticket)
+                    {
+                        slot.mask.fetch_and(~(std::uint32_t{ 1 } << stream), std::memory_order_relaxed);
+                    }
+                }
+
+                // async-signal-safe; calls f(fd, data, size) for every record not yet flushed to a stream, oldest first
+                // every record is copied out of its slot first, and is skipped if the slot was overwritten while it was being copied,
+                // so a record is never written out torn; records that were being written when this is called may end up in the output twice
+                template<typename F>
+                void drain(F && f)
+                {
+                    auto head = _head.load(std::memory_order_acquire);
+                    auto first = head >= _slot_count ? head - _slot_count + 1 : 1;
+
+                    char data[slot_size];
+
+                    for (auto ticket = first; ticket <= head; ++ticket)
+                    {
+                        auto & slot = _slots[ticket % _slot_count];
+                        if (slot.sequence.load(std::memory_order_acquire) != ticket)
+                        {
+                            continue;
+                        }
+
+                        auto size = std::min(slot.size, slot_size);
+                        std::memcpy(data, slot.data, size);
+                        auto mask = slot.mask.load(std::memory_order_relaxed);
+
+                        // seqlock-style: the copy is only good if the slot still holds the same record after it was made
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        if (slot.sequence.load(std::memory_order_relaxed) != ticket)
+                        {
+                            continue;
+                        }
+
+                        mask &= slot.mask.exchange(0, std::memory_order_relaxed);
+                        for (std::size_t i = 0; i < max_streams; ++i)
+                        {
+                            if (mask & (std::uint32_t{ 1 } << i))
+                            {
+                                f(_fds[i].load(std::memory_order_relaxed), data, size);
+                            }
+                        }
+                    }
+                }
+
+            private:
+                struct _slot
+                {
+                    std::atomic<std::uint64_t> sequence{ 0 };
+                    std::atomic<std::uint32_t> mask{ 0 };
+                    std::size_t size = 0;
+                    char data[slot_size];
+                };
+
+                static constexpr std::uint64_t _writing = ~std::uint64_t{ 0 };
+
+                static _string_buffer & _render_buffer()
+                {
+                    thread_local _string_buffer buffer;
+                    return buffer;
+                }
+
+                static stream_wrapper & _render_wrapper()
+                {
+                    thread_local std::ostream stream{ &_render_buffer() };
+                    thread_local stream_wrapper wrapper{ stream };
+                    return wrapper;
+                }
+
+                std::unique_ptr<_slot[]> _slots;
+                std::size_t _slot_count;
+                std::atomic<std::uint64_t> _head{ 0 };
+
+                std::array<std::string, level_count> _prefixes;
+
+                std::atomic<std::uint32_t> _streams{ 0 };
+                std::array<std::atomic<int>, max_streams> _fds;
+            };
+
+            constexpr std::size_t _max_crash_buffers = 64;
+
+            inline std::array<std::atomic<_crash_buffer *>, _max_crash_buffers> & _crash_buffers()
+            {
+                static std::array<std::atomic<_crash_buffer *>, _max_crash_buffers> buffers = {};
+                return buffers;
+            }
+
+            inline bool _register_crash_buffer(_crash_buffer * buffer)
+            {
+                for (auto & slot : _crash_buffers())
+                {
+                    _crash_buffer * expected = nullptr;
+                    if (slot.compare_exchange_strong(expected, buffer))
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            inline void _unregister_crash_buffer(_crash_buffer * buffer)
+            {
+                for (auto & slot : _crash_buffers())
+                {
+                    _crash_buffer * expected = buffer;
+                    if (slot.compare_exchange_strong(expected, nullptr))
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+}
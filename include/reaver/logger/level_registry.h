@@ -25,7 +25,7 @@
 #include <map>
 #include <vector>
 
-#include "../configuration.h"
+#include "../configuration/static_configuration.h"
 #include "../style.h"
 #include "streamable.h"
 
@@ -49,6 +49,8 @@ namespace logger
             always
         };
 
+        constexpr std::size_t level_count = static_cast<std::size_t>(base_level::always) + 1;
+
         struct hasher
         {
             auto operator()(const base_level & l) const
@@ -110,6 +112,8 @@ namespace logger
             }
         };
 
+        // the prefixes are rendered once, when a stream is added to a logger; registering a level again
+        // doesn't affect streams that already exist
         class level_registry
         {
         public:
@@ -120,13 +124,42 @@ namespace logger
             }
 
             template<typename T>
-            std::vector<streamable> operator[](T) const
+            const std::vector<streamable> & operator[](T) const
             {
                 return _config.get<T>();
             }
 
+            const std::vector<streamable> & operator[](base_level l) const
+            {
+                switch (l)
+                {
+                    case base_level::trace:
+                        return (*this)[trace];
+                    case base_level::debug:
+                        return (*this)[debug];
+                    case base_level::note:
+                        return (*this)[note];
+                    case base_level::info:
+                        return (*this)[info];
+                    case base_level::success:
+                        return (*this)[success];
+                    case base_level::warning:
+                        return (*this)[warning];
+                    case base_level::error:
+                        return (*this)[error];
+                    case base_level::fatal:
+                        return (*this)[fatal];
+                    case base_level::crash:
+                        return (*this)[crash];
+                    case base_level::always:
+                        return (*this)[always];
+                }
+
+                throw invalid_logger_level{};
+            }
+
         private:
-            configuration _config;
+            static_configuration<always_type, trace_type, debug_type, note_type, info_type, success_type, warning_type, error_type, fatal_type, crash_type> _config;
         };
 
         inline level_registry & default_level_registry()
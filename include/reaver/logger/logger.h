@@ -22,18 +22,18 @@
 
 #pragma once
 
-#include <condition_variable>
-#include <functional>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <thread>
 #include <vector>
 
-#include "../function.h"
 #include "../semaphore.h"
-#include "../style.h"
 #include "action.h"
 #include "level_registry.h"
+#include "sink.h"
+#include "statistics.h"
 
 namespace reaver
 {
@@ -44,58 +44,74 @@ namespace logger
         class logger
         {
         public:
-            logger(base_level level = info)
-                : _level{ level }, _worker{ [=]() {
-                      while (!_quit)
-                      {
-                          std::vector<unique_function<void()>> functions;
-
-                          {
-                              std::unique_lock<std::mutex> lock{ _lock };
-                              if (_queue.empty())
-                              {
-                                  _cv.wait(lock);
-                              }
-                              std::swap(functions, _queue);
-                          }
-
-                          for (auto && f : functions)
-                          {
-                              f();
-                          }
-                      }
-
-                      for (auto & stream : _streams)
-                      {
-                          stream << style::style();
-                      }
-                  } },
-                  _streams{}
+            logger(base_level level = info) : _level{ level }
             {
             }
 
             logger(std::ostream & stream, base_level level = info) : logger{ level }
             {
-                _streams.emplace_back(stream);
+                add_stream(stream);
+            }
+
+            void sync()
+            {
+                semaphore sem;
+
+                auto sinks = _current_sinks();
+                for (auto sink : *sinks)
+                {
+                    sink->push([&]() { sem.notify(); });
+                }
+
+                for (std::size_t count = sinks->size(); count; --count)
+                {
+                    sem.wait();
+                }
             }
 
             ~logger()
             {
-                _async([&]() { _quit = true; });
-                _worker.join();
+                if (_crash)
+                {
+                    _detail::_unregister_crash_buffer(_crash.get());
+                }
             }
 
-            void sync()
+            void add_stream(stream_wrapper stream)
             {
-                semaphore sem;
-                _async([&]() { sem.notify(); });
+                std::lock_guard<std::mutex> lock{ _sinks_lock };
+                _sinks.push_back(std::make_unique<_detail::_sink>(std::move(stream), _counters));
 
-                sem.wait();
+                if (_crash)
+                {
+                    _sinks.back()->attach(*_crash);
+                }
+
+                auto list = std::make_shared<std::vector<_detail::_sink *>>(*_sink_list);
+                list->push_back(_sinks.back().get());
+                _sink_list = std::move(list);
             }
 
-            void add_stream(stream_wrapper stream)
+            // keeps a rendered copy of the last `records` records in memory allocated up front, so that the ones
+            // that haven't reached their streams yet can be written out by emergency_flush() (see crash.h) when the
+            // process is going down; only streams with a known file descriptor (see stream_wrapper::fd()) take part
+            void enable_crash_flush(std::size_t records = 256)
             {
-                _streams.push_back(std::move(stream));
+                std::lock_guard<std::mutex> lock{ _sinks_lock };
+
+                if (_crash)
+                {
+                    return;
+                }
+
+                _crash = std::make_unique<_detail::_crash_buffer>(records);
+                for (auto & sink : _sinks)
+                {
+                    sink->attach(*_crash);
+                }
+
+                _detail::_register_crash_buffer(_crash.get());
+                _crash_pointer = _crash.get();
             }
 
             void set_level(base_level l = info)
@@ -103,33 +119,99 @@ namespace logger
                 _level = l;
             }
 
+            // by default the queues grow without bounds; with overflow_policy::block, producers wait while a stream
+            // has `high_water_mark` records pending, and with overflow_policy::drop such records are discarded
+            void set_overflow_policy(overflow_policy policy, std::size_t high_water_mark = 64 * 1024)
+            {
+                _high_water_mark = high_water_mark;
+                _policy = policy;
+            }
+
+            logger_statistics statistics()
+            {
+                logger_statistics ret;
+
+                ret.queue_depth = _counters.depth.load(std::memory_order_relaxed);
+                ret.records_written = _counters.records.load(std::memory_order_relaxed);
+                ret.bytes_written = _counters.bytes.load(std::memory_order_relaxed);
+                ret.dropped_records = _counters.dropped.load(std::memory_order_relaxed);
+
+                for (std::size_t i = 0; i < lag_histogram_size; ++i)
+                {
+                    ret.lag_histogram[i] = _counters.lag_histogram[i].load(std::memory_order_relaxed);
+                }
+
+                std::lock_guard<std::mutex> lock{ _statistics_lock };
+
+                auto now = std::chrono::steady_clock::now();
+                auto seconds = std::chrono::duration<double>(now - _last_statistics.time).count();
+                if (seconds > 0)
+                {
+                    ret.records_per_second = (ret.records_written - _last_statistics.records) / seconds;
+                    ret.bytes_per_second = (ret.bytes_written - _last_statistics.bytes) / seconds;
+                }
+
+                _last_statistics = { now, ret.records_written, ret.bytes_written };
+
+                return ret;
+            }
+
             template<typename T = always_type>
             action<T> operator()(T = {})
             {
-                return { *this, default_level_registry()[T{}] };
+                return { *this, nullptr };
             }
 
-            friend class logger_friend;
-
-        private:
-            void _async(unique_function<void()> f)
+            // the level and the call site are checked before the record is built, so that
+            // a suppressed record doesn't pay for formatting its arguments
+            template<typename T>
+            action<T> operator()(T, call_site & site)
             {
-                std::lock_guard<std::mutex> lock{ _lock };
-                _queue.push_back(std::move(f));
+                if (T{} < _level || !site.admit())
+                {
+                    return { *this, site, true };
+                }
 
-                _cv.notify_one();
+                return { *this, &site };
             }
 
-            std::atomic<bool> _quit{ false };
+            friend class logger_friend;
 
+        private:
             base_level _level;
 
-            std::condition_variable _cv;
-            std::mutex _lock;
-            std::thread _worker;
-            std::vector<unique_function<void()>> _queue;
+            std::atomic<overflow_policy> _policy{ overflow_policy::grow };
+            std::atomic<std::size_t> _high_water_mark{ 0 };
+
+            _detail::_counters _counters;
+
+            struct _snapshot
+            {
+                std::chrono::steady_clock::time_point time;
+                std::uint64_t records;
+                std::uint64_t bytes;
+            };
 
-            std::vector<stream_wrapper> _streams;
+            std::mutex _statistics_lock;
+            _snapshot _last_statistics{ std::chrono::steady_clock::now(), 0, 0 };
+
+            std::unique_ptr<_detail::_crash_buffer> _crash;
+            std::atomic<_detail::_crash_buffer *> _crash_pointer{ nullptr };
+
+            // the list of sinks that records are written to is replaced, not modified, when a stream is added; writers take a
+            // reference to the current one and write to it without holding the lock, so that a producer blocked on one stream
+            // doesn't hold up the others; sinks are never removed, so the pointers stay valid for as long as the logger lives
+            std::shared_ptr<const std::vector<_detail::_sink *>> _current_sinks()
+            {
+                std::lock_guard<std::mutex> lock{ _sinks_lock };
+                return _sink_list;
+            }
+
+            // every stream has its own queue and worker thread; see _detail::_sink
+            // must be destroyed before the counters and the crash buffer
+            std::mutex _sinks_lock;
+            std::vector<std::unique_ptr<_detail::_sink>> _sinks;
+            std::shared_ptr<const std::vector<_detail::_sink *>> _sink_list = std::make_shared<const std::vector<_detail::_sink *>>();
         };
 
         base_level logger_friend::_level(logger & l)
@@ -137,17 +219,26 @@ namespace logger
             return l._level;
         }
 
-        void logger_friend::_write(logger & l, std::vector<streamable> vec)
+        void logger_friend::_write(logger & l, base_level level, std::vector<streamable> vec)
         {
-            l._async([vec = std::move(vec), &l]() {
-                for (auto & stream : l._streams)
-                {
-                    for (const auto & x : vec)
-                    {
-                        x.stream(stream);
-                    }
-                }
-            });
+            _detail::_record rec{ level, std::move(vec) };
+
+            auto crash = l._crash_pointer.load(std::memory_order_acquire);
+            if (crash && crash->has_streams())
+            {
+                rec.crash = crash;
+                rec.crash_ticket = crash->publish(level, rec.streamables);
+            }
+
+            auto record = std::make_shared<const _detail::_record>(std::move(rec));
+            auto policy = l._policy.load(std::memory_order_relaxed);
+            auto high_water_mark = l._high_water_mark.load(std::memory_order_relaxed);
+
+            auto sinks = l._current_sinks();
+            for (auto sink : *sinks)
+            {
+                sink->write(record, policy, high_water_mark);
+            }
         }
 
         inline logger & default_logger()
@@ -161,6 +252,12 @@ namespace logger
         {
             return default_logger()(Level{});
         }
+
+        template<typename Level>
+        inline auto dlog(Level, call_site & site)
+        {
+            return default_logger()(Level{}, site);
+        }
     }
 }
 }
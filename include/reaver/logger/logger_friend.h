@@ -34,7 +34,7 @@ namespace logger
         class logger_friend
         {
         protected:
-            inline static void _write(logger &, std::vector<streamable>);
+            inline static void _write(logger &, base_level, std::vector<streamable>);
             inline static base_level _level(logger &);
         };
     }
@@ -0,0 +1,267 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../function.h"
+#include "../style.h"
+#include "crash_buffer.h"
+#include "level_registry.h"
+#include "statistics.h"
+#include "stream_wrapper.h"
+#include "streamable.h"
+
+namespace reaver
+{
+namespace logger
+{
+    inline namespace _v1
+    {
+        namespace _detail
+        {
+            struct _record
+            {
+                base_level level;
+                std::vector<streamable> streamables;
+
+                _crash_buffer * crash = nullptr;
+                std::uint64_t crash_ticket = 0;
+            };
+
+            // a single output stream of a logger, together with its own queue and worker thread,
+            // so that a slow stream only ever delays itself
+            // records pushed from a single thread are written in the order they were pushed in
+            // records are formatted into a buffer first, and then written to the stream in large chunks
+            class _sink
+            {
+            public:
+                _sink(stream_wrapper stream, _counters & counters)
+                    : _stream{ std::move(stream) }, _stats{ counters }, _render{ _render_stream }, _worker{ [this]() {
+                          while (!_quit)
+                          {
+                              std::vector<unique_function<void()>> functions;
+
+                              {
+                                  std::unique_lock<std::mutex> lock{ _lock };
+                                  if (_queue.empty())
+                                  {
+                                      _cv.wait(lock);
+                                  }
+                                  std::swap(functions, _queue);
+                              }
+
+                              for (auto && f : functions)
+                              {
+                                  f();
+                              }
+
+                              _drain();
+                          }
+
+                          _stream << style::style();
+                      } }
+                {
+                    style::enable_ansi(_render_stream, style::uses_ansi(_stream.get()));
+
+                    // the level prefixes are the same for every record, so they are rendered just once
+                    for (std::size_t i = 0; i < level_count; ++i)
+                    {
+                        for (const auto & x : default_level_registry()[static_cast<base_level>(i)])
+                        {
+                            x.stream(_render);
+                        }
+
+                        _prefixes[i] = std::move(_buffer.str());
+                        _buffer.str().clear();
+                    }
+                }
+
+                ~_sink()
+                {
+                    push([&]() { _quit = true; });
+                    _worker.join();
+                }
+
+                // returns false if the record was dropped
+                bool write(std::shared_ptr<const _record> record, overflow_policy policy, std::size_t high_water_mark)
+                {
+                    std::unique_lock<std::mutex> lock{ _lock };
+
+                    if (policy != overflow_policy::grow && _pending >= high_water_mark)
+                    {
+                        if (policy == overflow_policy::drop)
+                        {
+                            _stats.dropped.fetch_add(1, std::memory_order_relaxed);
+                            _release(*record);
+                            return false;
+                        }
+
+                        ++_blocked;
+                        _space.wait(lock, [&]() { return _pending < high_water_mark; });
+                        --_blocked;
+                    }
+
+                    ++_pending;
+                    _stats.depth.fetch_add(1, std::memory_order_relaxed);
+
+                    _queue.push_back([this, record = std::move(record), queued = std::chrono::steady_clock::now()]() {
+                        _buffer.str() += _prefixes[static_cast<std::size_t>(record->level)];
+                        for (const auto & x : record->streamables)
+                        {
+                            x.stream(_render);
+                        }
+
+                        _queued.push_back({ queued, record->crash, record->crash_ticket });
+                        if (_buffer.str().size() >= _drain_threshold)
+                        {
+                            _drain();
+                        }
+                    });
+
+                    _cv.notify_one();
+                    return true;
+                }
+
+                // records published in the crash buffer after this is called will be emergency flushed to this stream
+                void attach(_crash_buffer & crash)
+                {
+                    auto fd = _stream.fd();
+                    if (fd >= 0)
+                    {
+                        _crash_stream = crash.add_stream(fd);
+                    }
+                }
+
+                // anything pushed here runs after all the records queued before it are written to the stream
+                void push(unique_function<void()> f)
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+                    _queue.push_back([this, f = std::move(f)]() mutable {
+                        _drain();
+                        f();
+                    });
+
+                    _cv.notify_one();
+                }
+
+            private:
+                void _drain()
+                {
+                    if (_queued.empty())
+                    {
+                        return;
+                    }
+
+                    auto & buffer = _buffer.str();
+                    _stream.get().write(buffer.data(), buffer.size());
+                    _stream.get().flush();
+
+                    auto now = std::chrono::steady_clock::now();
+                    for (auto & queued : _queued)
+                    {
+                        _stats.record_lag(now - queued.time);
+                        if (queued.crash)
+                        {
+                            _release(*queued.crash, queued.crash_ticket);
+                        }
+                    }
+
+                    _stats.records.fetch_add(_queued.size(), std::memory_order_relaxed);
+                    _stats.bytes.fetch_add(buffer.size(), std::memory_order_relaxed);
+                    _stats.depth.fetch_sub(_queued.size(), std::memory_order_relaxed);
+                    _pending -= _queued.size();
+
+                    buffer.clear();
+                    _queued.clear();
+
+                    if (_blocked)
+                    {
+                        std::lock_guard<std::mutex> lock{ _lock };
+                        _space.notify_all();
+                    }
+                }
+
+                void _release(const _record & record)
+                {
+                    if (record.crash)
+                    {
+                        _release(*record.crash, record.crash_ticket);
+                    }
+                }
+
+                void _release(_crash_buffer & crash, std::uint64_t ticket)
+                {
+                    auto index = _crash_stream.load(std::memory_order_relaxed);
+                    if (index >= 0)
+                    {
+                        crash.release(ticket, index);
+                    }
+                }
+
+                struct _queued_record
+                {
+                    std::chrono::steady_clock::time_point time;
+                    _crash_buffer * crash;
+                    std::uint64_t crash_ticket;
+                };
+
+                static constexpr std::size_t _drain_threshold = 64 * 1024;
+
+                std::atomic<bool> _quit{ false };
+
+                stream_wrapper _stream;
+                _counters & _stats;
+
+                _string_buffer _buffer;
+                std::ostream _render_stream{ &_buffer };
+                stream_wrapper _render;
+                std::array<std::string, level_count> _prefixes;
+                std::vector<_queued_record> _queued;
+                std::atomic<int> _crash_stream{ -1 };
+
+                std::condition_variable _cv;
+                std::condition_variable _space;
+                std::mutex _lock;
+                std::vector<unique_function<void()>> _queue;
+                std::atomic<std::size_t> _pending{ 0 };
+                std::atomic<std::size_t> _blocked{ 0 };
+
+                // must stay the last member; the worker uses all of the above
+                std::thread _worker;
+            };
+        }
+    }
+}
+}
@@ -0,0 +1,93 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace reaver
+{
+namespace logger
+{
+    inline namespace _v1
+    {
+        // what happens to a record when a stream already has `high_water_mark` records waiting
+        enum class overflow_policy
+        {
+            grow,
+            block,
+            drop
+        };
+
+        constexpr std::size_t lag_histogram_size = 32;
+
+        struct logger_statistics
+        {
+            // records waiting to be written, summed over all streams
+            std::size_t queue_depth = 0;
+
+            // the following are counted once for every stream a record is written to
+            std::uint64_t records_written = 0;
+            std::uint64_t bytes_written = 0;
+            std::uint64_t dropped_records = 0;
+
+            // measured since the previous call to logger::statistics()
+            double records_per_second = 0;
+            double bytes_per_second = 0;
+
+            // the time between a record being queued and it being written to a stream
+            // bucket 0 counts lags below 1us, bucket i counts lags in [2^(i-1), 2^i) us; the last bucket also counts everything above
+            std::array<std::uint64_t, lag_histogram_size> lag_histogram = {};
+        };
+
+        namespace _detail
+        {
+            struct _counters
+            {
+                void record_lag(std::chrono::steady_clock::duration lag)
+                {
+                    auto us = std::chrono::duration_cast<std::chrono::microseconds>(lag).count();
+
+                    std::size_t bucket = 0;
+                    while (us > 0 && bucket < lag_histogram_size - 1)
+                    {
+                        us >>= 1;
+                        ++bucket;
+                    }
+
+                    lag_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+                }
+
+                std::atomic<std::size_t> depth{ 0 };
+                std::atomic<std::uint64_t> records{ 0 };
+                std::atomic<std::uint64_t> bytes{ 0 };
+                std::atomic<std::uint64_t> dropped{ 0 };
+                std::array<std::atomic<std::uint64_t>, lag_histogram_size> lag_histogram = {};
+            };
+        }
+    }
+}
+}
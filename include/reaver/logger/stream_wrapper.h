@@ -22,8 +22,11 @@
 
 #pragma once
 
+#include <iostream>
 #include <memory>
 #include <ostream>
+#include <streambuf>
+#include <string>
 
 namespace reaver
 {
@@ -33,6 +36,35 @@ namespace logger
     {
         namespace _detail
         {
+            class _string_buffer : public std::streambuf
+            {
+            public:
+                std::string & str()
+                {
+                    return _buffer;
+                }
+
+            protected:
+                virtual int_type overflow(int_type ch) override
+                {
+                    if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                    {
+                        _buffer.push_back(traits_type::to_char_type(ch));
+                    }
+
+                    return traits_type::not_eof(ch);
+                }
+
+                virtual std::streamsize xsputn(const char * s, std::streamsize count) override
+                {
+                    _buffer.append(s, count);
+                    return count;
+                }
+
+            private:
+                std::string _buffer;
+            };
+
             class _stream_wrapper_impl
             {
             public:
@@ -79,7 +111,7 @@ namespace logger
         class stream_wrapper
         {
         public:
-            stream_wrapper(std::ostream & stream) : _impl{ new _detail::_stream_ref_wrapper{ stream } }
+            stream_wrapper(std::ostream & stream) : _impl{ new _detail::_stream_ref_wrapper{ stream } }, _fd{ _standard_fd(stream) }
             {
             }
 
@@ -87,9 +119,29 @@ namespace logger
             {
             }
 
+            // `fd` is the file descriptor the stream ends up writing to; it is only used by the emergency flush
+            stream_wrapper(std::ostream & stream, int fd) : _impl{ new _detail::_stream_ref_wrapper{ stream } }, _fd{ fd }
+            {
+            }
+
+            stream_wrapper(std::unique_ptr<std::ostream> & stream, int fd) : _impl{ new _detail::_stream_uptr_wrapper{ std::move(stream) } }, _fd{ fd }
+            {
+            }
+
             stream_wrapper(const stream_wrapper &) = default;
             stream_wrapper(stream_wrapper &&) = default;
 
+            std::ostream & get()
+            {
+                return _impl->get();
+            }
+
+            // -1 when unknown
+            int fd() const
+            {
+                return _fd;
+            }
+
             template<typename T>
             stream_wrapper & operator<<(T && rhs)
             {
@@ -98,7 +150,23 @@ namespace logger
             }
 
         private:
+            static int _standard_fd(std::ostream & stream)
+            {
+                if (&stream == &std::cout)
+                {
+                    return 1;
+                }
+
+                if (&stream == &std::cerr || &stream == &std::clog)
+                {
+                    return 2;
+                }
+
+                return -1;
+            }
+
             std::unique_ptr<_detail::_stream_wrapper_impl> _impl;
+            int _fd = -1;
         };
     }
 }
@@ -0,0 +1,353 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exception.h"
+
+namespace reaver
+{
+inline namespace _v1
+{
+    // how the pages of a mapped file are going to be accessed; passed on to the kernel with madvise
+    enum class access_pattern
+    {
+        normal,
+        sequential,
+        random
+    };
+
+    struct mapping_options
+    {
+        access_pattern access = access_pattern::sequential;
+
+        // start reading the whole file into the page cache right away
+        bool will_need = false;
+
+        // ask for transparent huge pages; only honored by kernels and filesystems that support them for file mappings
+        bool huge_pages = false;
+    };
+
+    namespace _detail
+    {
+        // opens the file for reading, and throws file_not_found, file_is_directory or file_failed_to_open when that isn't possible
+        inline int _open_for_reading(const std::string & path, struct stat & info)
+        {
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == ENOENT)
+                {
+                    throw file_not_found{ path };
+                }
+
+                throw file_failed_to_open{ path };
+            }
+
+            if (::fstat(fd, &info) < 0)
+            {
+                ::close(fd);
+                throw file_failed_to_open{ path };
+            }
+
+            if (S_ISDIR(info.st_mode))
+            {
+                ::close(fd);
+                throw file_is_directory{ path };
+            }
+
+            return fd;
+        }
+
+        inline void _advise(void * data, std::size_t size, const mapping_options & options)
+        {
+            // these are hints; a kernel that doesn't know one of them just returns an error, which changes nothing
+            switch (options.access)
+            {
+                case access_pattern::sequential:
+                    ::madvise(data, size, MADV_SEQUENTIAL);
+                    break;
+                case access_pattern::random:
+                    ::madvise(data, size, MADV_RANDOM);
+                    break;
+                case access_pattern::normal:
+                    break;
+            }
+
+            if (options.will_need)
+            {
+                ::madvise(data, size, MADV_WILLNEED);
+            }
+
+#ifdef MADV_HUGEPAGE
+            if (options.huge_pages)
+            {
+                ::madvise(data, size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+    }
+
+    // a whole file, mapped read-only into memory
+    // the file must not be truncated while it's mapped; reading pages past the new end of the file raises SIGBUS
+    class mapped_file
+    {
+    public:
+        mapped_file(const std::string & path, mapping_options options = {})
+        {
+            struct stat info;
+            auto fd = _detail::_open_for_reading(path, info);
+
+            _size = info.st_size;
+            if (_size)
+            {
+                auto data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw file_failed_to_open{ path };
+                }
+
+                _detail::_advise(data, _size, options);
+                _data = static_cast<const char *>(data);
+            }
+
+            // the mapping keeps the file alive on its own
+            ::close(fd);
+        }
+
+        mapped_file(const mapped_file &) = delete;
+        mapped_file & operator=(const mapped_file &) = delete;
+
+        mapped_file(mapped_file && other) noexcept : _data{ std::exchange(other._data, nullptr) }, _size{ std::exchange(other._size, 0) }
+        {
+        }
+
+        mapped_file & operator=(mapped_file && other) noexcept
+        {
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+            return *this;
+        }
+
+        ~mapped_file()
+        {
+            if (_data)
+            {
+                ::munmap(const_cast<char *>(_data), _size);
+            }
+        }
+
+        const char * data() const
+        {
+            return _data;
+        }
+
+        std::size_t size() const
+        {
+            return _size;
+        }
+
+        bool empty() const
+        {
+            return !_size;
+        }
+
+        const char * begin() const
+        {
+            return _data;
+        }
+
+        const char * end() const
+        {
+            return _data + _size;
+        }
+
+        char operator[](std::size_t index) const
+        {
+            return _data[index];
+        }
+
+        std::string_view contents() const
+        {
+            return { _data, _size };
+        }
+
+        // like std::span::subspan; count is clamped to the end of the file
+        std::string_view subspan(std::size_t offset, std::size_t count = std::string_view::npos) const
+        {
+            return contents().substr(offset, count);
+        }
+
+    private:
+        const char * _data = nullptr;
+        std::size_t _size = 0;
+    };
+
+    // reads a file a chunk at a time, so that at most a single chunk of it is mapped at any point
+    // regular files are mapped a window at a time; anything that can't be mapped, like a pipe, is read() into a buffer instead
+    // chunks are cut at fixed offsets, so records that cross a chunk boundary have to be stitched together by the caller
+    class chunked_file_reader
+    {
+    public:
+        static constexpr std::size_t default_chunk_size = 64 * 1024 * 1024;
+
+        chunked_file_reader(const std::string & path, std::size_t chunk_size = default_chunk_size, mapping_options options = {})
+            : _path{ path }, _options{ options }
+        {
+            struct stat info;
+            _fd = _detail::_open_for_reading(path, info);
+
+            // windows have to start at page boundaries
+            auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            _chunk_size = std::max(page_size, (chunk_size + page_size - 1) / page_size * page_size);
+
+            if (S_ISREG(info.st_mode))
+            {
+                _size = info.st_size;
+                _mapped = true;
+                ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+
+            else
+            {
+                _buffer = std::make_unique<char[]>(_chunk_size);
+            }
+        }
+
+        chunked_file_reader(const chunked_file_reader &) = delete;
+        chunked_file_reader & operator=(const chunked_file_reader &) = delete;
+
+        ~chunked_file_reader()
+        {
+            _unmap();
+            ::close(_fd);
+        }
+
+        // returns the next chunk of the file, which stays valid until the next call; an empty view means the end of the file
+        std::string_view next()
+        {
+            return _mapped ? _next_window() : _next_read();
+        }
+
+        // the offset of the chunk returned by the last call to next()
+        std::uint64_t offset() const
+        {
+            return _offset;
+        }
+
+    private:
+        std::string_view _next_window()
+        {
+            _unmap();
+
+            _offset = _next_offset;
+            if (_offset >= _size)
+            {
+                return {};
+            }
+
+            _window_size = static_cast<std::size_t>(std::min<std::uint64_t>(_chunk_size, _size - _offset));
+            auto data = ::mmap(nullptr, _window_size, PROT_READ, MAP_PRIVATE, _fd, _offset);
+            if (data == MAP_FAILED)
+            {
+                throw file_failed_to_open{ _path };
+            }
+
+            _detail::_advise(data, _window_size, _options);
+            _window = static_cast<const char *>(data);
+            _next_offset = _offset + _window_size;
+
+            return { _window, _window_size };
+        }
+
+        std::string_view _next_read()
+        {
+            _offset = _next_offset;
+
+            std::size_t size = 0;
+            while (size < _chunk_size)
+            {
+                auto result = ::read(_fd, _buffer.get() + size, _chunk_size - size);
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw file_failed_to_open{ _path };
+                }
+
+                if (result == 0)
+                {
+                    break;
+                }
+
+                size += result;
+            }
+
+            _next_offset = _offset + size;
+            return { _buffer.get(), size };
+        }
+
+        void _unmap()
+        {
+            if (!_window)
+            {
+                return;
+            }
+
+            ::munmap(const_cast<char *>(_window), _window_size);
+            _window = nullptr;
+        }
+
+        std::string _path;
+        mapping_options _options;
+        int _fd = -1;
+        std::size_t _chunk_size = 0;
+
+        bool _mapped = false;
+        std::uint64_t _size = 0;
+        const char * _window = nullptr;
+        std::size_t _window_size = 0;
+        std::unique_ptr<char[]> _buffer;
+
+        std::uint64_t _offset = 0;
+        std::uint64_t _next_offset = 0;
+    };
+}
+}
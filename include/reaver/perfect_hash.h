@@ -0,0 +1,188 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace reaver
+{
+inline namespace _v1
+{
+    namespace _detail
+    {
+        constexpr std::uint64_t _perfect_hash(std::string_view key, std::uint64_t seed)
+        {
+            // FNV-1a, with the seed mixed into the offset basis
+            std::uint64_t hash = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+            for (auto c : key)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ull;
+            }
+
+            return hash ^ (hash >> 32);
+        }
+
+        constexpr std::size_t _perfect_hash_table_size(std::size_t keys)
+        {
+            std::size_t size = 1;
+            while (size < 2 * keys)
+            {
+                size <<= 1;
+            }
+
+            return size;
+        }
+    }
+
+    // a hash table over a set of strings known at compile time, without any collisions between them
+    // built with hash-and-displace: the keys are split into buckets by one hash, and every bucket gets a seed for the second hash,
+    // chosen so that all of the keys land in distinct slots; a lookup is therefore two hashes and a single comparison
+    // empty keys are skipped; duplicate keys make the construction fail (at compile time, if it's a constant expression)
+    template<std::size_t N>
+    class perfect_hash
+    {
+    public:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        constexpr perfect_hash(const std::array<std::string_view, N> & keys) : _keys{ keys }
+        {
+            for (auto & slot : _slots)
+            {
+                slot = npos;
+            }
+
+            std::array<std::size_t, N> bucket_of{};
+            std::array<std::size_t, _bucket_count> sizes{};
+
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                for (std::size_t j = 0; j < i; ++j)
+                {
+                    if (!keys[i].empty() && keys[i] == keys[j])
+                    {
+                        throw std::logic_error{ "duplicate key in a perfect_hash" };
+                    }
+                }
+
+                if (!keys[i].empty())
+                {
+                    bucket_of[i] = _detail::_perfect_hash(keys[i], 0) % _bucket_count;
+                    ++sizes[bucket_of[i]];
+                }
+            }
+
+            // the largest buckets are the hardest to place, so they go first
+            std::array<bool, _bucket_count> placed{};
+            for (std::size_t n = 0; n < _bucket_count; ++n)
+            {
+                std::size_t bucket = 0;
+                while (placed[bucket])
+                {
+                    ++bucket;
+                }
+
+                for (std::size_t i = bucket + 1; i < _bucket_count; ++i)
+                {
+                    if (!placed[i] && sizes[i] > sizes[bucket])
+                    {
+                        bucket = i;
+                    }
+                }
+
+                placed[bucket] = true;
+                if (sizes[bucket])
+                {
+                    _place(keys, bucket_of, bucket);
+                }
+            }
+        }
+
+        // returns the index of the key in the array the table was created from, or npos
+        constexpr std::size_t find(std::string_view key) const
+        {
+            auto seed = _seeds[_detail::_perfect_hash(key, 0) % _bucket_count];
+            auto index = _slots[_detail::_perfect_hash(key, seed) & (_table_size - 1)];
+            return index != npos && _keys[index] == key ? index : npos;
+        }
+
+    private:
+        constexpr void _place(const std::array<std::string_view, N> & keys, const std::array<std::size_t, N> & bucket_of, std::size_t bucket)
+        {
+            for (std::uint64_t seed = 1; seed < _max_seed; ++seed)
+            {
+                std::array<std::size_t, N> claimed{};
+                std::size_t claimed_count = 0;
+                bool fits = true;
+
+                for (std::size_t i = 0; i < N && fits; ++i)
+                {
+                    if (keys[i].empty() || bucket_of[i] != bucket)
+                    {
+                        continue;
+                    }
+
+                    auto slot = _detail::_perfect_hash(keys[i], seed) & (_table_size - 1);
+                    fits = _slots[slot] == npos;
+                    for (std::size_t j = 0; j < claimed_count && fits; ++j)
+                    {
+                        fits = claimed[j] != slot;
+                    }
+
+                    claimed[claimed_count++] = slot;
+                }
+
+                if (!fits)
+                {
+                    continue;
+                }
+
+                for (std::size_t i = 0, j = 0; i < N; ++i)
+                {
+                    if (!keys[i].empty() && bucket_of[i] == bucket)
+                    {
+                        _slots[claimed[j++]] = i;
+                    }
+                }
+
+                _seeds[bucket] = seed;
+                return;
+            }
+
+            throw std::logic_error{ "failed to find a perfect hash seed" };
+        }
+
+        static constexpr std::size_t _bucket_count = N / 2 + 1;
+        static constexpr std::size_t _table_size = _detail::_perfect_hash_table_size(N);
+        static constexpr std::uint64_t _max_seed = 1 << 20;
+
+        std::array<std::string_view, N> _keys{};
+        std::array<std::uint64_t, _bucket_count> _seeds{};
+        std::array<std::size_t, _table_size> _slots{};
+    };
+}
+}
@@ -1,7 +1,7 @@
 /**
  * Reaver Library Licence
  *
- * Copyright © 2016 Michał "Griwes" Dominiak
+ * Copyright © 2016, 2026 Michał "Griwes" Dominiak
  *
  * This software is provided 'as-is', without any express or implied
  * warranty. In no event will the authors be held liable for any damages
@@ -22,11 +22,21 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "exception.h"
+#include "future.h"
+#include "hazard_pointer.h"
+#include "tpl/index_of.h"
+#include "tpl/vector.h"
 
 namespace reaver
 {
@@ -62,10 +72,19 @@ inline namespace _v1
         std::string library;
     };
 
+    // lazy binding resolves the functions a library calls on their first call, eager binding does all of it when the library is opened
+    // eager binding makes opening slower, but keeps the resolution off of the first calls, and reports missing dependencies up front
+    enum class plugin_binding
+    {
+        lazy,
+        eager
+    };
+
     class plugin
     {
     public:
-        plugin(std::string name) : _handle{ _posix::dlopen(("lib" + name + ".so").c_str(), RTLD_LAZY) }, _name{ std::move(name) }
+        plugin(std::string name, plugin_binding binding = plugin_binding::lazy)
+            : _handle{ _posix::dlopen(("lib" + name + ".so").c_str(), binding == plugin_binding::eager ? RTLD_NOW : RTLD_LAZY) }, _name{ std::move(name) }
         {
             if (!_handle)
             {
@@ -78,25 +97,288 @@ inline namespace _v1
             _posix::dlclose(_handle);
         }
 
+        // symbols are looked up with dlsym only once; later lookups of the same name are served from a cache
         template<typename T>
         T * get_symbol(const std::string & name) const
         {
-            auto ret = reinterpret_cast<T *>(_posix::dlsym(_handle, name.c_str()));
-            if (!ret)
+            return reinterpret_cast<T *>(_lookup(name));
+        }
+
+        const std::string & name() const
+        {
+            return _name;
+        }
+
+        // the handle returned by dlopen; the dynamic linker returns the same handle for every name that resolves to the same file
+        void * native_handle() const
+        {
+            return _handle;
+        }
+
+    private:
+        void * _lookup(const std::string & name) const
+        {
+            std::lock_guard<std::mutex> lock{ _symbols_lock };
+
+            auto it = _symbols.find(name);
+            if (it != _symbols.end())
+            {
+                return it->second;
+            }
+
+            auto symbol = _posix::dlsym(_handle, name.c_str());
+            if (!symbol)
             {
                 throw symbol_not_found{ name, _name };
             }
-            return ret;
+
+            _symbols.emplace(name, symbol);
+            return symbol;
         }
 
-    private:
         void * _handle;
         std::string _name;
+
+        mutable std::mutex _symbols_lock;
+        mutable std::unordered_map<std::string, void *> _symbols;
+    };
+
+    // hands out a single plugin object for every library that is open, no matter how many times, or under how many names, it's opened
+    // the registry doesn't keep the libraries alive; a library is closed once the last plugin, plugin_function and plugin_interface
+    // referring to it are gone, and opening it after that loads it anew
+    // find() never blocks: it costs an atomic load, publishing a hazard pointer, a hash lookup and a reference count increment
+    // open() only takes a lock when the library isn't open yet
+    class plugin_registry
+    {
+    public:
+        plugin_registry() : _current{ new _table{} }
+        {
+        }
+
+        plugin_registry(const plugin_registry &) = delete;
+        plugin_registry & operator=(const plugin_registry &) = delete;
+
+        // there must not be any calls to find() or open() in progress when the registry is destroyed
+        ~plugin_registry()
+        {
+            delete _current.load();
+            for (auto table : _retired)
+            {
+                delete table;
+            }
+        }
+
+        // returns an empty pointer if the library isn't open
+        std::shared_ptr<plugin> find(const std::string & name) const
+        {
+            hazard_pointer hazard;
+            auto table = hazard.protect(_current);
+
+            auto it = table->find(name);
+            if (it == table->end())
+            {
+                return nullptr;
+            }
+
+            return it->second.library.lock();
+        }
+
+        // the binding mode only matters when the library is actually loaded by this call
+        // the library is loaded without holding any locks of the registry, so its static initializers are free to open other libraries
+        std::shared_ptr<plugin> open(const std::string & name, plugin_binding binding = plugin_binding::lazy)
+        {
+            if (auto ret = find(name))
+            {
+                return ret;
+            }
+
+            auto state = std::make_shared<_unload_state>();
+            std::shared_ptr<plugin> ret{ new plugin{ name, binding }, [state](plugin * p) {
+                                            delete p;
+                                            state->closed();
+                                        } };
+
+            std::lock_guard<std::mutex> lock{ _write_lock };
+
+            // the same file opened in the meantime, or opened before under a different name;
+            // dropping the new object undoes the extra dlopen
+            for (auto && entry : *_current.load(std::memory_order_relaxed))
+            {
+                auto existing = entry.second.library.lock();
+                if (existing && (entry.first == name || existing->native_handle() == ret->native_handle()))
+                {
+                    ret = std::move(existing);
+                    state = entry.second.state;
+                    break;
+                }
+            }
+
+            _publish([&](_table & table) { table[name] = _entry{ ret, std::move(state) }; });
+            return ret;
+        }
+
+        // removes the library, under every name it was opened as, from the registry, so that the next open() loads it anew
+        // the returned future becomes ready once the library is closed, i.e. once every plugin, plugin_function and plugin_interface
+        // referring to it, and with that every call into it, is gone; waiting for it before opening the library again is what makes
+        // reloading a plugin pick up the new version of the file
+        future<void> unload(const std::string & name)
+        {
+            std::shared_ptr<_unload_state> state;
+
+            {
+                std::lock_guard<std::mutex> lock{ _write_lock };
+
+                auto & current = *_current.load(std::memory_order_relaxed);
+                auto it = current.find(name);
+                if (it == current.end())
+                {
+                    return make_ready_future();
+                }
+
+                state = it->second.state;
+                _publish([&](_table & table) {
+                    for (auto entry = table.begin(); entry != table.end();)
+                    {
+                        entry = entry->second.state == state ? table.erase(entry) : std::next(entry);
+                    }
+                });
+            }
+
+            return state->wait();
+        }
+
+    private:
+        class _unload_state
+        {
+        public:
+            void closed()
+            {
+                std::vector<manual_promise<void>> waiting;
+
+                {
+                    std::lock_guard<std::mutex> lock{ _lock };
+                    _closed = true;
+                    std::swap(waiting, _waiting);
+                }
+
+                for (auto && promise : waiting)
+                {
+                    promise.set();
+                }
+            }
+
+            future<void> wait()
+            {
+                std::lock_guard<std::mutex> lock{ _lock };
+                if (_closed)
+                {
+                    return make_ready_future();
+                }
+
+                auto pair = make_promise<void>();
+                _waiting.push_back(std::move(pair.promise));
+                return std::move(pair.future);
+            }
+
+        private:
+            std::mutex _lock;
+            bool _closed = false;
+            std::vector<manual_promise<void>> _waiting;
+        };
+
+        struct _entry
+        {
+            std::weak_ptr<plugin> library;
+            std::shared_ptr<_unload_state> state;
+        };
+
+        using _table = std::unordered_map<std::string, _entry>;
+
+        // copies the current table without the libraries that were closed in the meantime, modifies the copy and publishes it
+        template<typename F>
+        void _publish(F && f)
+        {
+            auto next = std::make_unique<_table>();
+            for (auto && entry : *_current.load(std::memory_order_relaxed))
+            {
+                if (!entry.second.library.expired())
+                {
+                    next->emplace(entry);
+                }
+            }
+
+            std::forward<F>(f)(*next);
+
+            _retired.reserve(_retired.size() + 1);
+            _retired.push_back(_current.exchange(next.release()));
+            retire_if_unused(_retired);
+        }
+
+        std::atomic<const _table *> _current;
+
+        std::mutex _write_lock;
+        std::vector<const _table *> _retired;
+    };
+
+    inline plugin_registry & default_plugin_registry()
+    {
+        static plugin_registry registry;
+        return registry;
+    }
+
+    // opening the same library again, while it's still open, returns the same plugin object
+    inline std::shared_ptr<plugin> open_library(const std::string & name, plugin_binding binding = plugin_binding::lazy)
+    {
+        return default_plugin_registry().open(name, binding);
+    }
+
+    // a plugin for load_plugins() to load, together with the symbols to look up in it right away
+    struct plugin_request
+    {
+        std::string name;
+        std::vector<std::string> symbols = {};
+        plugin_binding binding = plugin_binding::eager;
     };
 
-    inline std::shared_ptr<plugin> open_library(const std::string & name)
+    struct loaded_plugin
     {
-        return std::make_shared<plugin>(name);
+        std::shared_ptr<plugin> library;
+
+        // opening the library, including running its static initializers, and looking up the requested symbols
+        std::chrono::steady_clock::duration load_time;
+        std::chrono::steady_clock::duration resolve_time;
+    };
+
+    // loads every plugin in a separate task on sched; the symbols looked up end up in the plugin's symbol cache, so plugin_functions
+    // and plugin_interfaces created later don't need to call dlsym
+    // a future fails with library_not_found or symbol_not_found; the other plugins are loaded regardless
+    // glibc's dynamic linker loads a single library at a time, so loads running at the same time wait for each other, and the waiting
+    // counts towards their load_time; an executor with a single thread gives times that can be compared between plugins
+    // the registry must outlive all of the returned futures becoming ready
+    inline std::vector<future<loaded_plugin>> load_plugins(std::shared_ptr<executor> sched,
+        std::vector<plugin_request> requests,
+        plugin_registry & registry = default_plugin_registry())
+    {
+        std::vector<future<loaded_plugin>> ret;
+        ret.reserve(requests.size());
+
+        for (auto && request : requests)
+        {
+            ret.push_back(async(sched, [&registry, request = std::move(request)]() {
+                auto start = std::chrono::steady_clock::now();
+                auto library = registry.open(request.name, request.binding);
+                auto loaded = std::chrono::steady_clock::now();
+
+                for (auto && symbol : request.symbols)
+                {
+                    library->get_symbol<void>(symbol);
+                }
+
+                return loaded_plugin{ std::move(library), loaded - start, std::chrono::steady_clock::now() - loaded };
+            }));
+        }
+
+        return ret;
     }
 
     template<typename Signature>
@@ -128,6 +410,12 @@ inline namespace _v1
 
         using signature = Ret(Args...);
 
+        // the raw function pointer, for hot loops; only valid for as long as this object (or a copy of it) is alive
+        signature * get() const
+        {
+            return _function;
+        }
+
         template<typename T>
         friend struct std::hash;
 
@@ -135,6 +423,129 @@ inline namespace _v1
         std::shared_ptr<plugin> _plugin;
         signature * _function;
     };
+
+    template<typename Signature>
+    class hot_plugin_function;
+
+    // a plugin_function that can be switched over to a newly loaded library while it's being called
+    // a call loads the current function pointer and publishes it in a hazard pointer for the duration of the call; there are no locks
+    // and no shared reference counts on the call path
+    template<typename Ret, typename... Args>
+    class hot_plugin_function<Ret(Args...)>
+    {
+    public:
+        using signature = Ret(Args...);
+
+        hot_plugin_function(std::shared_ptr<plugin> plugin, std::string name) : _name{ std::move(name) }
+        {
+            auto function = plugin->get_symbol<signature>(_name);
+            _current.store(new _binding{ std::move(plugin), function }, std::memory_order_release);
+        }
+
+        hot_plugin_function(const hot_plugin_function &) = delete;
+        hot_plugin_function & operator=(const hot_plugin_function &) = delete;
+
+        // there must not be any calls in progress when this is destroyed
+        ~hot_plugin_function()
+        {
+            delete _current.load();
+        }
+
+        Ret operator()(Args... args) const
+        {
+            hazard_pointer hazard;
+            return hazard.protect(_current)->function(std::forward<Args>(args)...);
+        }
+
+        // looks the function up in the new library and makes every call started from now on use it; if the symbol isn't there,
+        // throws symbol_not_found and keeps using the old library
+        // blocks until the calls into the old library that were already in progress return, and then releases it; so it must not be
+        // called from inside a call made through this object
+        // the dynamic linker returns the library that is already loaded when the same file is opened again, so a new version
+        // of a plugin has to be loaded from a different file than the one it's replacing
+        void reload(std::shared_ptr<plugin> plugin)
+        {
+            std::lock_guard<std::mutex> lock{ _reload_lock };
+
+            auto function = plugin->get_symbol<signature>(_name);
+            std::vector<const _binding *> retired{ _current.exchange(new _binding{ std::move(plugin), function }) };
+
+            while (true)
+            {
+                retire_if_unused(retired);
+                if (retired.empty())
+                {
+                    return;
+                }
+
+                std::this_thread::yield();
+            }
+        }
+
+        const std::string & name() const
+        {
+            return _name;
+        }
+
+        // the library that calls are currently made into
+        std::shared_ptr<plugin> library() const
+        {
+            hazard_pointer hazard;
+            return hazard.protect(_current)->library;
+        }
+
+    private:
+        struct _binding
+        {
+            std::shared_ptr<plugin> library;
+            signature * function;
+        };
+
+        std::string _name;
+        std::atomic<const _binding *> _current{ nullptr };
+        std::mutex _reload_lock;
+    };
+
+    // a function exported by a plugin, to be listed in a plugin_interface
+    // usage: struct init : reaver::plugin_symbol<int(const char *)> { static constexpr const char name[] = "plugin_init"; };
+    template<typename Signature>
+    struct plugin_symbol
+    {
+        using signature = Signature;
+    };
+
+    // resolves all of the listed symbols once, when constructed, into a flat tuple of function pointers
+    // calls through it are plain indirect calls; there is no lookup, no reference counting and no extra forwarding layer
+    template<typename... Symbols>
+    class plugin_interface
+    {
+    public:
+        plugin_interface(std::shared_ptr<plugin> plugin)
+            : _plugin{ std::move(plugin) }, _functions{ _plugin->get_symbol<typename Symbols::signature>(Symbols::name)... }
+        {
+        }
+
+        template<typename Symbol>
+        typename Symbol::signature * get() const
+        {
+            return std::get<tpl::index_of<tpl::vector<Symbols...>, Symbol>::value>(_functions);
+        }
+
+        template<typename Symbol, typename... Args>
+        decltype(auto) call(Args &&... args) const
+        {
+            return get<Symbol>()(std::forward<Args>(args)...);
+        }
+
+        const std::shared_ptr<plugin> & library() const
+        {
+            return _plugin;
+        }
+
+    private:
+        std::shared_ptr<plugin> _plugin;
+        std::tuple<typename Symbols::signature *...> _functions;
+    };
 }
 }
 
@@ -1,7 +1,7 @@
 /**
  * Reaver Library Licence
  *
- * Copyright © 2012-2013, 2017, 2019 Michał "Griwes" Dominiak
+ * Copyright © 2012-2013, 2017, 2019, 2026 Michał "Griwes" Dominiak
  *
  * This software is provided 'as-is', without any express or implied
  * warranty. In no event will the authors be held liable for any damages
@@ -96,12 +96,43 @@ namespace style
 #error unsupported platform
 #endif
 
-        // stdout and stderr only supported at the moment
+        inline int ansi_index()
+        {
+            static const int index = std::ios_base::xalloc();
+            return index;
+        }
+
+        // escape sequences are written to stdout and stderr when they are terminals, and to any other stream
+        // that explicitly asked for them (for instance a buffer that is later copied to a terminal)
+        inline void enable_ansi(std::ostream & stream, bool enable = true)
+        {
+            stream.iword(ansi_index()) = enable;
+        }
+
+        inline bool uses_ansi(std::ostream & stream)
+        {
+#ifdef __unix__
+            // checked once; a process doesn't get its standard streams redirected under its feet
+            if (&stream == &std::cout)
+            {
+                static const bool is_terminal = unix_details::isatty(unix_details::stdout_fileno);
+                return is_terminal;
+            }
+
+            if (&stream == &std::cerr)
+            {
+                static const bool is_terminal = unix_details::isatty(unix_details::stderr_fileno);
+                return is_terminal;
+            }
+#endif
+
+            return stream.iword(ansi_index());
+        }
+
         inline std::ostream & operator<<(std::ostream & stream, const reaver::style::style & style)
         {
 #ifdef __unix__
-            if ((&stream == &std::cout && unix_details::isatty(unix_details::stdout_fileno))
-                || (&stream == &std::cerr && unix_details::isatty(unix_details::stderr_fileno)))
+            if (uses_ansi(stream))
             {
                 stream << "\033[" << static_cast<std::uint16_t>(style._style) << ';' << static_cast<std::uint16_t>(style._forecolor) << ';'
                        << static_cast<std::uint16_t>(style._backcolor) + 10 << 'm';
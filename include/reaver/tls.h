@@ -1,7 +1,7 @@
 /**
  * Reaver Library Licence
  *
- * Copyright © 2015 Michał "Griwes" Dominiak
+ * Copyright © 2015, 2026 Michał "Griwes" Dominiak
  *
  * This software is provided 'as-is', without any express or implied
  * warranty. In no event will the authors be held liable for any damages
@@ -22,17 +22,30 @@
 
 #pragma once
 
-#include <pthread.h>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
-// on linuxes, this will pretty much always include pthread, so the above
-// include is not harmful
-// (it'd be if it was the only one that included the symbols)
 #include "exception.h"
+#include "function.h"
+
+// the thread-local pointer per_thread goes through is accessed with the initial-exec model, i.e. with a single load
+// relative to the thread pointer, instead of a call to __tls_get_addr; it's a single pointer, so it fits in the space
+// the dynamic linker reserves for libraries that are dlopen()ed, too
+#if defined(__GNUC__)
+#define REAVER_INITIAL_EXEC_TLS __attribute__((tls_model("initial-exec")))
+#else
+#define REAVER_INITIAL_EXEC_TLS
+#endif
 
 namespace reaver
 {
 inline namespace _v1
 {
+    // kept for the code that used to catch it; creating thread-local variables can't fail anymore
     class tls_creation_exception : public exception
     {
     public:
@@ -44,58 +57,258 @@ inline namespace _v1
 
     namespace _detail
     {
-#ifdef __unix__
-        using _handle = pthread_key_t;
-        inline void _initialize(_handle & h)
+        struct _per_thread_slot
+        {
+            void * object = nullptr;
+            void * owner = nullptr;
+            void (*exit)(void * owner, void * object) = nullptr;
+            void (*destroy)(void *) = nullptr;
+        };
+
+        struct _thread_slots;
+
+        // the list of threads that have per_thread objects, and the ids of per_thread variables
+        // deliberately never destroyed, since threads can still exit after static destructors run
+        struct _per_thread_registry
+        {
+            std::mutex lock;
+            std::vector<_thread_slots *> threads;
+            std::vector<std::size_t> free_ids;
+            std::size_t next_id = 0;
+        };
+
+        inline _per_thread_registry & _per_thread_variables()
+        {
+            static auto registry = new _per_thread_registry;
+            return *registry;
+        }
+
+        inline _thread_slots *& _current_thread_slots()
+        {
+            static thread_local _thread_slots * slots REAVER_INITIAL_EXEC_TLS = nullptr;
+            return slots;
+        }
+
+        // the objects of a single thread, indexed by the ids of per_thread variables
+        // only the owning thread adds slots; every modification is done with the registry locked
+        struct _thread_slots
         {
-            if (pthread_key_create(&h, nullptr))
+            _thread_slots()
             {
-                throw tls_creation_exception{};
+                auto & registry = _per_thread_variables();
+                std::lock_guard<std::mutex> lock{ registry.lock };
+                registry.threads.push_back(this);
+                _current_thread_slots() = this;
             }
+
+            ~_thread_slots()
+            {
+                _current_thread_slots() = nullptr;
+
+                std::vector<_per_thread_slot> objects;
+
+                {
+                    auto & registry = _per_thread_variables();
+                    std::lock_guard<std::mutex> lock{ registry.lock };
+                    registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+                    std::swap(objects, slots);
+
+                    // the lock keeps the owners alive; their destructors take it to destroy the instances they can find
+                    for (auto && slot : objects)
+                    {
+                        if (slot.object)
+                        {
+                            slot.exit(slot.owner, slot.object);
+                        }
+                    }
+                }
+
+                for (auto && slot : objects)
+                {
+                    if (slot.object)
+                    {
+                        slot.destroy(slot.object);
+                    }
+                }
+            }
+
+            std::vector<_per_thread_slot> slots;
+        };
+
+        inline _thread_slots & _register_thread()
+        {
+            static thread_local _thread_slots slots;
+            return slots;
         }
+    }
 
-        inline void * _read(_handle h)
+    // a separate instance of T for every thread that uses it, constructed on the first use in that thread and destroyed when the thread exits
+    // finding the current thread's instance is a thread-local load, a bounds check and an indexed load; locks are only taken the first time
+    // a thread uses a per_thread, when a thread that used any exits, and in for_each()
+    // T's destructor must not use per_thread variables; it runs when the thread is exiting
+    // on_exit is called with the instance of every thread that exits, before it's destroyed, e.g. to merge it into a total; the calls
+    // are made with a lock held, so they don't overlap, and they must not use per_thread variables either
+    // the instances that are still alive when the per_thread is destroyed aren't passed to it; for_each() can reach them before that
+    template<typename T>
+    class per_thread
+    {
+    public:
+        per_thread() : per_thread{ [] { return T{}; } }
         {
-            return pthread_getspecific(h);
         }
 
-        inline void _write(_handle h, void * ptr)
+        per_thread(unique_function<T() const> make) : per_thread{ std::move(make), [](T &) {} }
         {
-            pthread_setspecific(h, ptr);
         }
-#endif
-    }
 
+        per_thread(unique_function<T() const> make, unique_function<void(T &)> on_exit) : _make{ std::move(make) }, _on_exit{ std::move(on_exit) }
+        {
+            auto & registry = _detail::_per_thread_variables();
+            std::lock_guard<std::mutex> lock{ registry.lock };
+
+            if (registry.free_ids.empty())
+            {
+                _id = registry.next_id++;
+            }
+            else
+            {
+                _id = registry.free_ids.back();
+                registry.free_ids.pop_back();
+            }
+        }
+
+        per_thread(const per_thread &) = delete;
+        per_thread & operator=(const per_thread &) = delete;
+
+        // destroys the instances of all threads; none of them may be in use anymore
+        ~per_thread()
+        {
+            std::vector<void *> objects;
+
+            {
+                auto & registry = _detail::_per_thread_variables();
+                std::lock_guard<std::mutex> lock{ registry.lock };
+
+                for (auto thread : registry.threads)
+                {
+                    if (_id < thread->slots.size() && thread->slots[_id].object)
+                    {
+                        objects.push_back(std::exchange(thread->slots[_id].object, nullptr));
+                    }
+                }
+
+                registry.free_ids.push_back(_id);
+            }
+
+            for (auto object : objects)
+            {
+                _destroy(object);
+            }
+        }
+
+        T & get()
+        {
+            auto thread = _detail::_current_thread_slots();
+            if (thread && _id < thread->slots.size())
+            {
+                if (auto object = thread->slots[_id].object)
+                {
+                    return static_cast<_instance *>(object)->value;
+                }
+            }
+
+            return _create();
+        }
+
+        T & operator*()
+        {
+            return get();
+        }
+
+        T * operator->()
+        {
+            return &get();
+        }
+
+        // calls f(T &) with the instance of every thread that has one; threads can't create or destroy their instances while this runs,
+        // but they can use them, so T must be safe to access from f while its owner uses it, e.g. a set of atomic counters
+        // f must not use per_thread variables
+        template<typename F>
+        void for_each(F && f) const
+        {
+            auto & registry = _detail::_per_thread_variables();
+            std::lock_guard<std::mutex> lock{ registry.lock };
+
+            for (auto thread : registry.threads)
+            {
+                if (_id < thread->slots.size() && thread->slots[_id].object)
+                {
+                    f(static_cast<_instance *>(thread->slots[_id].object)->value);
+                }
+            }
+        }
+
+    private:
+        T & _create()
+        {
+            auto & thread = _detail::_register_thread();
+            std::unique_ptr<_instance> object{ new _instance{ _make() } };
+
+            auto & registry = _detail::_per_thread_variables();
+            std::lock_guard<std::mutex> lock{ registry.lock };
+
+            if (thread.slots.size() <= _id)
+            {
+                thread.slots.resize(_id + 1);
+            }
+
+            thread.slots[_id] = { object.get(), this, &_exit, &_destroy };
+            return object.release()->value;
+        }
+
+        // every instance gets cache lines of its own, so that threads updating their instances don't slow each other down
+        struct alignas(64) _instance
+        {
+            T value;
+        };
+
+        static void _exit(void * owner, void * object)
+        {
+            static_cast<per_thread *>(owner)->_on_exit(static_cast<_instance *>(object)->value);
+        }
+
+        static void _destroy(void * object)
+        {
+            delete static_cast<_instance *>(object);
+        }
+
+        unique_function<T() const> _make;
+        unique_function<void(T &)> _on_exit;
+        std::size_t _id;
+    };
+
+    // a per_thread variable that every thread sees with the same initial value, for types that are cheap to copy around
     template<typename T>
     class tls_variable
     {
     public:
-        static_assert(sizeof(T) <= sizeof(void *),
-            "tls_variable is currently only available for "
-            "types of sizes up to the size of `void *`.");
-        static_assert(std::is_trivially_destructible<T>::value && std::is_trivial<T>::value, "tls_variable is currently only available for trivial types.");
-
-        tls_variable(T initial = T{})
+        tls_variable(T initial = T{}) : _value{ [initial = std::move(initial)] { return initial; } }
         {
-            _detail::_initialize(_handle);
-            *this = initial;
         }
 
         operator T() const
         {
-            // to avoid errors about narrowing conversions
-            auto ptr = _detail::_read(_handle);
-            return *reinterpret_cast<T *>(&ptr);
+            return *_value;
         }
 
         auto & operator=(const T & t)
         {
-            _detail::_write(_handle, reinterpret_cast<void *>(t));
+            *_value = t;
             return *this;
         }
 
     private:
-        _detail::_handle _handle;
+        mutable per_thread<T> _value;
     };
 }
 }
@@ -1,7 +1,7 @@
 /**
  * Reaver Library Licence
  *
- * Copyright © 2014 Michał "Griwes" Dominiak
+ * Copyright © 2014, 2026 Michał "Griwes" Dominiak
  *
  * This software is provided 'as-is', without any express or implied
  * warranty. In no event will the authors be held liable for any damages
@@ -22,7 +22,15 @@
 
 #pragma once
 
-#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace reaver
 {
@@ -30,34 +38,440 @@ namespace wildcard
 {
     inline namespace _v1
     {
-        inline bool match(const std::string & pattern, const std::string & string, std::size_t pattern_position = 0, std::size_t string_position = 0)
+        namespace _detail
+        {
+            // a run of the pattern without stars, matched at a given position of the string
+            inline bool _piece_matches_at(std::string_view piece, bool has_question_mark, std::string_view string, std::size_t position)
+            {
+                if (!has_question_mark)
+                {
+                    return string.compare(position, piece.size(), piece) == 0;
+                }
+
+                for (std::size_t i = 0; i < piece.size(); ++i)
+                {
+                    if (piece[i] != '?' && piece[i] != string[position + i])
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            // the leftmost position, not before position, at which the piece matches the string
+            inline std::size_t _find_piece(std::string_view piece, bool has_question_mark, std::string_view string, std::size_t position)
+            {
+                if (!has_question_mark)
+                {
+                    return string.find(piece, position);
+                }
+
+                for (; position + piece.size() <= string.size(); ++position)
+                {
+                    if (_piece_matches_at(piece, true, string, position))
+                    {
+                        return position;
+                    }
+                }
+
+                return std::string_view::npos;
+            }
+        }
+
+        // a pattern with `*` (any sequence of characters) and `?` (any single character), preprocessed once, and matched in linear time
+        // the pattern is split on stars into pieces; the first piece has to match at the start of the string, and the last one at the end,
+        // and the pieces in between are each matched at the leftmost position after the previous one, which can't make a match fail
+        // when any match exists, so there is never any backtracking
+        class compiled_pattern
         {
-            if (pattern_position == pattern.size() || string_position == string.size())
+        public:
+            compiled_pattern(std::string_view pattern) : _pattern{ pattern }
+            {
+                std::size_t begin = 0;
+                while (true)
+                {
+                    auto end = _pattern.find('*', begin);
+                    auto size = (end == std::string::npos ? _pattern.size() : end) - begin;
+
+                    // consecutive stars are the same as a single star, but an empty first or last piece still anchors the string
+                    if (size || begin == 0 || end == std::string::npos)
+                    {
+                        _pieces.push_back({ begin, size, std::string_view{ _pattern }.substr(begin, size).find('?') != std::string_view::npos });
+                        _min_length += size;
+                    }
+
+                    if (end == std::string::npos)
+                    {
+                        break;
+                    }
+
+                    begin = end + 1;
+                }
+            }
+
+            bool matches(std::string_view string) const
+            {
+                if (string.size() < _min_length)
+                {
+                    return false;
+                }
+
+                if (_pieces.size() == 1)
+                {
+                    return string.size() == _min_length && _matches_at(_pieces.front(), string, 0);
+                }
+
+                const auto & prefix = _pieces.front();
+                const auto & suffix = _pieces.back();
+
+                if (!_matches_at(prefix, string, 0) || !_matches_at(suffix, string, string.size() - suffix.size))
+                {
+                    return false;
+                }
+
+                auto position = prefix.size;
+                auto end = string.size() - suffix.size;
+
+                for (std::size_t i = 1; i + 1 < _pieces.size(); ++i)
+                {
+                    position = _find(_pieces[i], string.substr(0, end), position);
+                    if (position == std::string_view::npos)
+                    {
+                        return false;
+                    }
+
+                    position += _pieces[i].size;
+                }
+
+                return true;
+            }
+
+            bool is_literal() const
+            {
+                return _pieces.size() == 1 && !_pieces.front().has_question_mark;
+            }
+
+            const std::string & pattern() const
+            {
+                return _pattern;
+            }
+
+        private:
+            struct _piece
+            {
+                std::size_t offset;
+                std::size_t size;
+                bool has_question_mark;
+            };
+
+            bool _matches_at(const _piece & piece, std::string_view string, std::size_t position) const
+            {
+                return _detail::_piece_matches_at(std::string_view{ _pattern }.substr(piece.offset, piece.size), piece.has_question_mark, string, position);
+            }
+
+            std::size_t _find(const _piece & piece, std::string_view string, std::size_t position) const
+            {
+                return _detail::_find_piece(std::string_view{ _pattern }.substr(piece.offset, piece.size), piece.has_question_mark, string, position);
+            }
+
+            std::string _pattern;
+            std::vector<_piece> _pieces;
+            std::size_t _min_length = 0;
+        };
+
+        // many patterns matched against a name at once
+        // every pattern contributes its longest run of characters that aren't wildcards to an Aho-Corasick automaton, which finds all of
+        // those literals in the name in a single pass; only the patterns whose literal was found, and patterns that have no literal at all,
+        // are then checked with their compiled_pattern
+        // the automaton is a flat transition table over classes of bytes, so a byte costs one table lookup, regardless of the number of patterns
+        class pattern_set
+        {
+        public:
+            pattern_set(std::initializer_list<std::string_view> patterns) : pattern_set{ std::vector<std::string_view>(patterns) }
+            {
+            }
+
+            template<typename Range>
+            pattern_set(const Range & patterns)
+            {
+                std::vector<std::string> literals;
+
+                for (auto && pattern : patterns)
+                {
+                    auto index = _patterns.size();
+                    _patterns.emplace_back(pattern);
+
+                    auto literal = _longest_literal(_patterns.back().pattern());
+                    if (literal.empty())
+                    {
+                        _unfiltered.push_back(index);
+                        continue;
+                    }
+
+                    auto it = std::find(literals.begin(), literals.end(), literal);
+                    if (it == literals.end())
+                    {
+                        literals.emplace_back(literal);
+                        _literal_patterns.emplace_back();
+                        it = literals.end() - 1;
+                    }
+
+                    _literal_patterns[it - literals.begin()].push_back(index);
+                }
+
+                _build(literals);
+            }
+
+            std::size_t size() const
+            {
+                return _patterns.size();
+            }
+
+            const compiled_pattern & operator[](std::size_t index) const
+            {
+                return _patterns[index];
+            }
+
+            // replaces the contents of out with the indices of the patterns that match name, in ascending order
+            void matches(std::string_view name, std::vector<std::size_t> & out) const
+            {
+                out.clear();
+
+                _scan(name, [&](std::int32_t literal) {
+                    for (auto index : _literal_patterns[literal])
+                    {
+                        out.push_back(index);
+                    }
+                    return false;
+                });
+
+                std::sort(out.begin(), out.end());
+                out.erase(std::unique(out.begin(), out.end()), out.end());
+                out.erase(std::remove_if(out.begin(), out.end(), [&](std::size_t index) { return !_patterns[index].matches(name); }), out.end());
+
+                auto candidates = out.size();
+                for (auto index : _unfiltered)
+                {
+                    if (_patterns[index].matches(name))
+                    {
+                        out.push_back(index);
+                    }
+                }
+
+                std::inplace_merge(out.begin(), out.begin() + candidates, out.end());
+            }
+
+            std::vector<std::size_t> matches(std::string_view name) const
+            {
+                std::vector<std::size_t> ret;
+                matches(name, ret);
+                return ret;
+            }
+
+            // stops at the first matching pattern
+            bool matches_any(std::string_view name) const
             {
-                if (pattern_position == pattern.size() && string_position == string.size())
+                for (auto index : _unfiltered)
                 {
-                    return true;
+                    if (_patterns[index].matches(name))
+                    {
+                        return true;
+                    }
                 }
 
-                if (pattern_position == pattern.size() - 1 && pattern[pattern_position] == '*')
+                return _scan(name, [&](std::int32_t literal) {
+                    return std::any_of(
+                        _literal_patterns[literal].begin(), _literal_patterns[literal].end(), [&](std::size_t index) { return _patterns[index].matches(name); });
+                });
+            }
+
+        private:
+            static std::string_view _longest_literal(std::string_view pattern)
+            {
+                std::string_view ret;
+
+                std::size_t begin = 0;
+                while (begin < pattern.size())
                 {
-                    return true;
+                    auto end = std::min(pattern.find_first_of("*?", begin), pattern.size());
+                    if (end - begin > ret.size())
+                    {
+                        ret = pattern.substr(begin, end - begin);
+                    }
+
+                    begin = end + 1;
+                }
+
+                return ret;
+            }
+
+            void _build(const std::vector<std::string> & literals)
+            {
+                // bytes that don't appear in any literal all behave the same, so they share class 0
+                _classes.fill(0);
+                for (auto && literal : literals)
+                {
+                    for (unsigned char c : literal)
+                    {
+                        if (!_classes[c])
+                        {
+                            _classes[c] = static_cast<std::uint16_t>(++_class_count);
+                        }
+                    }
+                }
+                ++_class_count;
+
+                _transitions.assign(_class_count, -1);
+                _output.assign(1, -1);
+
+                for (std::size_t i = 0; i < literals.size(); ++i)
+                {
+                    std::int32_t state = 0;
+                    for (unsigned char c : literals[i])
+                    {
+                        auto & next = _transitions[state * _class_count + _classes[c]];
+                        if (next < 0)
+                        {
+                            next = static_cast<std::int32_t>(_output.size());
+                            _output.push_back(-1);
+                            _transitions.resize(_transitions.size() + _class_count, -1);
+                        }
+
+                        state = _transitions[state * _class_count + _classes[c]];
+                    }
+
+                    _output[state] = static_cast<std::int32_t>(i);
+                }
+
+                // turn the trie into a DFA, breadth first, so that the failure state of every state is complete before it's needed
+                std::vector<std::int32_t> failure(_output.size(), 0);
+                _output_link.assign(_output.size(), -1);
+
+                std::queue<std::int32_t> queue;
+                for (std::size_t c = 0; c < _class_count; ++c)
+                {
+                    auto & next = _transitions[c];
+                    if (next < 0)
+                    {
+                        next = 0;
+                    }
+
+                    else
+                    {
+                        queue.push(next);
+                    }
+                }
+
+                while (!queue.empty())
+                {
+                    auto state = queue.front();
+                    queue.pop();
+
+                    for (std::size_t c = 0; c < _class_count; ++c)
+                    {
+                        auto fallback = _transitions[failure[state] * _class_count + c];
+                        auto & next = _transitions[state * _class_count + c];
+
+                        if (next < 0)
+                        {
+                            next = fallback;
+                            continue;
+                        }
+
+                        failure[next] = fallback;
+                        _output_link[next] = _output[fallback] >= 0 ? fallback : _output_link[fallback];
+                        queue.push(next);
+                    }
+                }
+            }
+
+            // calls f(literal) for every occurrence of every literal in name; stops early when f returns true
+            template<typename F>
+            bool _scan(std::string_view name, F && f) const
+            {
+                if (_literal_patterns.empty())
+                {
+                    return false;
+                }
+
+                std::int32_t state = 0;
+                for (unsigned char c : name)
+                {
+                    state = _transitions[state * _class_count + _classes[c]];
+
+                    for (auto output = _output[state] >= 0 ? state : _output_link[state]; output >= 0; output = _output_link[output])
+                    {
+                        if (f(_output[output]))
+                        {
+                            return true;
+                        }
+                    }
                 }
 
                 return false;
             }
 
-            if (pattern[pattern_position] == '*')
+            std::vector<compiled_pattern> _patterns;
+            std::vector<std::size_t> _unfiltered;
+            std::vector<std::vector<std::size_t>> _literal_patterns;
+
+            std::array<std::uint16_t, 256> _classes;
+            std::size_t _class_count = 0;
+            std::vector<std::int32_t> _transitions;
+            std::vector<std::int32_t> _output;
+            std::vector<std::int32_t> _output_link;
+        };
+
+        // matches like compiled_pattern, walking the pieces of the pattern as it goes, so that nothing is allocated
+        // patterns that are matched many times should still be compiled once, since this finds the pieces again on every call
+        inline bool match(const std::string & pattern, const std::string & string, std::size_t pattern_position = 0, std::size_t string_position = 0)
+        {
+            auto text = std::string_view{ pattern }.substr(pattern_position);
+            auto name = std::string_view{ string }.substr(string_position);
+
+            auto has_question_mark = [](std::string_view piece) { return piece.find('?') != std::string_view::npos; };
+
+            auto first_star = text.find('*');
+            if (first_star == std::string_view::npos)
+            {
+                return text.size() == name.size() && _detail::_piece_matches_at(text, has_question_mark(text), name, 0);
+            }
+
+            auto last_star = text.rfind('*');
+            auto prefix = text.substr(0, first_star);
+            auto suffix = text.substr(last_star + 1);
+
+            if (name.size() < prefix.size() + suffix.size() || !_detail::_piece_matches_at(prefix, has_question_mark(prefix), name, 0)
+                || !_detail::_piece_matches_at(suffix, has_question_mark(suffix), name, name.size() - suffix.size()))
             {
-                return match(pattern, string, pattern_position, string_position + 1) || match(pattern, string, pattern_position + 1, string_position);
+                return false;
             }
 
-            if (pattern[pattern_position] == '?' || pattern[pattern_position] == string[string_position])
+            auto position = prefix.size();
+            auto end = name.size() - suffix.size();
+
+            for (auto begin = first_star + 1; begin < last_star;)
             {
-                return match(pattern, string, pattern_position + 1, string_position + 1);
+                auto star = text.find('*', begin);
+                auto piece = text.substr(begin, star - begin);
+                begin = star + 1;
+
+                if (piece.empty())
+                {
+                    continue;
+                }
+
+                position = _detail::_find_piece(piece, has_question_mark(piece), name.substr(0, end), position);
+                if (position == std::string_view::npos)
+                {
+                    return false;
+                }
+
+                position += piece.size();
             }
 
-            return false;
+            return true;
         }
     }
 }
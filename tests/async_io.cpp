@@ -0,0 +1,101 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <reaver/mayfly.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+
+#include "async_io.h"
+#include "thread_pool.h"
+
+namespace
+{
+template<typename T>
+auto wait(reaver::future<T> future)
+{
+    while (true)
+    {
+        if (auto value = future.try_get())
+        {
+            return *value;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void read_and_write(unsigned queue_depth)
+{
+    auto path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    MAYFLY_REQUIRE(fd >= 0);
+
+    {
+        reaver::async_io io{ std::make_shared<reaver::thread_pool>(2), queue_depth };
+
+        MAYFLY_CHECK(wait(io.write_at(fd, "hello, ", 7, 0)) == 7);
+        MAYFLY_CHECK(wait(io.write_at(fd, "world", 5, 7)) == 5);
+        wait(io.fsync(fd, true));
+
+        char buffer[16] = {};
+        MAYFLY_CHECK(wait(io.read_at(fd, buffer, sizeof(buffer), 0)) == 12);
+        MAYFLY_CHECK(std::string(buffer, 12) == "hello, world");
+
+        char first[5] = {};
+        char second[5] = {};
+        auto batch = io.make_batch();
+        auto first_read = batch.read_at(fd, first, 5, 0);
+        auto second_read = batch.read_at(fd, second, 5, 7);
+        batch.submit();
+
+        MAYFLY_CHECK(wait(std::move(first_read)) == 5);
+        MAYFLY_CHECK(wait(std::move(second_read)) == 5);
+        MAYFLY_CHECK(std::string(first, 5) == "hello");
+        MAYFLY_CHECK(std::string(second, 5) == "world");
+
+        MAYFLY_CHECK_THROWS_TYPE(reaver::async_io_error, wait(io.read_at(-1, buffer, sizeof(buffer), 0)));
+    }
+
+    ::close(fd);
+    boost::filesystem::remove(path);
+}
+}
+
+MAYFLY_BEGIN_SUITE("async io");
+
+MAYFLY_ADD_TESTCASE("io_uring", [] { read_and_write(64); });
+
+MAYFLY_ADD_TESTCASE("fallback", [] {
+    reaver::async_io io{ std::make_shared<reaver::thread_pool>(1), 0 };
+    MAYFLY_CHECK(!io.uses_io_uring());
+
+    read_and_write(0);
+});
+
+MAYFLY_END_SUITE;
@@ -24,9 +24,21 @@
 
 #include <boost/functional/hash.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 namespace test
 {
 #include "configuration.h"
+#include "thread_pool.h"
 }
 
 namespace
@@ -91,6 +103,25 @@ struct tag_with_default
     using type = int;
     static constexpr int default_value = 1;
 };
+
+struct tag_with_converted_default
+{
+    using type = std::string;
+    static constexpr const char * default_value = "default";
+};
+
+int default_factory_calls = 0;
+
+struct tag_with_default_factory
+{
+    using type = std::vector<int>;
+
+    static type default_value()
+    {
+        ++default_factory_calls;
+        return { 1, 2, 3 };
+    }
+};
 }
 
 MAYFLY_BEGIN_SUITE("configuration");
@@ -166,6 +197,23 @@ MAYFLY_ADD_TESTCASE("tag with default value", [] {
     MAYFLY_REQUIRE(config.get<tag_with_default>() == tag_with_default::default_value + 1);
 });
 
+MAYFLY_ADD_TESTCASE("default values are not stored", [] {
+    const test::reaver::configuration first;
+    test::reaver::configuration second;
+
+    MAYFLY_CHECK(&first.get<tag_with_default>() == &tag_with_default::default_value);
+    MAYFLY_CHECK(first.get<tag_with_converted_default>() == "default");
+    MAYFLY_CHECK(&first.get<tag_with_converted_default>() == &second.get<tag_with_converted_default>());
+
+    MAYFLY_CHECK(first.get<tag_with_default_factory>() == std::vector<int>{ 1, 2, 3 });
+    MAYFLY_CHECK(second.get<tag_with_default_factory>() == std::vector<int>{ 1, 2, 3 });
+    MAYFLY_CHECK(default_factory_calls == 1);
+
+    second.set<tag_with_converted_default>("set");
+    MAYFLY_CHECK(second.get<tag_with_converted_default>() == "set");
+    MAYFLY_CHECK(first.get<tag_with_converted_default>() == "default");
+});
+
 MAYFLY_BEGIN_SUITE("bound");
 
 namespace
@@ -286,5 +334,156 @@ MAYFLY_ADD_TESTCASE("invalid construct from bound", [] {
     MAYFLY_REQUIRE(check_invalid_construct<test::reaver::bound_configuration<another_tag>, decltype(one)>(test::reaver::select_overload{}));
 });
 
+MAYFLY_END_SUITE;
+
+MAYFLY_BEGIN_SUITE("static");
+
+MAYFLY_ADD_TESTCASE("storing data", [] {
+    test::reaver::static_configuration<simple_tag, another_tag, explicitly_constructing_tag, identity_constructing_tag> config;
+
+    config.set<simple_tag>(1);
+    config.set<another_tag>(2);
+    MAYFLY_CHECK(config.get<simple_tag>() == 1);
+    MAYFLY_CHECK(config.get<another_tag>() == 2);
+
+    config.set<explicitly_constructing_tag>(1234);
+    MAYFLY_CHECK(config.get<explicitly_constructing_tag>() == "1234");
+
+    config.set(identity_constructing_tag{}, std::string{ "fizz" });
+    MAYFLY_CHECK(config.get(identity_constructing_tag{}) == "fizz buzz");
+
+    const auto & const_config = config;
+    MAYFLY_CHECK(&const_config.get<simple_tag>() == &config.get<simple_tag>());
+});
+
+MAYFLY_ADD_TESTCASE("initial values", [] {
+    test::reaver::static_configuration<simple_tag, tag_with_default> config;
+    MAYFLY_CHECK(config.get<simple_tag>() == 0);
+    MAYFLY_CHECK(config.get<tag_with_default>() == tag_with_default::default_value);
+});
+
+MAYFLY_ADD_TESTCASE("construct from configuration", [] {
+    test::reaver::configuration config;
+    config.set<simple_tag>(1);
+    config.set<identity_constructing_tag>(std::string{ "fizz" });
+
+    test::reaver::static_configuration<simple_tag, identity_constructing_tag> static_config = config;
+    MAYFLY_CHECK(static_config.get<simple_tag>() == 1);
+    MAYFLY_CHECK(static_config.get<identity_constructing_tag>() == "fizz buzz");
+
+    MAYFLY_REQUIRE_THROWS_TYPE(std::out_of_range, (test::reaver::static_configuration<simple_tag, another_tag>{ config }));
+});
+
+MAYFLY_ADD_TESTCASE("invalid set and get", [] {
+    MAYFLY_REQUIRE(check_invalid_set<another_tag, test::reaver::static_configuration<simple_tag>>(test::reaver::select_overload{}));
+    MAYFLY_REQUIRE(check_invalid_get<another_tag, test::reaver::static_configuration<simple_tag>>(test::reaver::select_overload{}));
+});
+
+MAYFLY_END_SUITE;
+
+MAYFLY_BEGIN_SUITE("shared");
+
+MAYFLY_ADD_TESTCASE("snapshots", [] {
+    test::reaver::shared_configuration<> config;
+    config.set<simple_tag>(1);
+
+    auto before = config.snapshot();
+    MAYFLY_CHECK(before.get<simple_tag>() == 1);
+
+    config.set<simple_tag>(2);
+    MAYFLY_CHECK(before.get<simple_tag>() == 1);
+    MAYFLY_CHECK(config.snapshot().get<simple_tag>() == 2);
+    MAYFLY_CHECK(config.get<simple_tag>() == 2);
+});
+
+MAYFLY_ADD_TESTCASE("update", [] {
+    test::reaver::shared_configuration<test::reaver::static_configuration<simple_tag, another_tag>> config;
+
+    config.update([](auto & c) {
+        c.template set<simple_tag>(1);
+        c.template set<another_tag>(2);
+    });
+
+    MAYFLY_CHECK(config.get<simple_tag>() == 1);
+    MAYFLY_CHECK(config.get<another_tag>() == 2);
+
+    MAYFLY_REQUIRE_THROWS_TYPE(int, config.update([](auto & c) {
+        c.template set<simple_tag>(3);
+        throw 0;
+    }));
+    MAYFLY_CHECK(config.get<simple_tag>() == 1);
+});
+
+MAYFLY_ADD_TESTCASE("concurrent readers", [] {
+    test::reaver::shared_configuration<test::reaver::static_configuration<simple_tag, another_tag>> config;
+    std::atomic<bool> done{ false };
+    std::atomic<bool> consistent{ true };
+
+    std::vector<std::thread> readers;
+    for (auto i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]() {
+            while (!done)
+            {
+                auto snapshot = config.snapshot();
+                if (snapshot.get<simple_tag>() != snapshot.get<another_tag>())
+                {
+                    consistent = false;
+                }
+            }
+        });
+    }
+
+    for (auto i = 0; i < 10000; ++i)
+    {
+        config.update([&](auto & c) {
+            c.template set<simple_tag>(i);
+            c.template set<another_tag>(i);
+        });
+    }
+
+    done = true;
+    for (auto && reader : readers)
+    {
+        reader.join();
+    }
+
+    MAYFLY_CHECK(consistent);
+});
+
+MAYFLY_ADD_TESTCASE("change notifications", [] {
+    auto pool = std::make_shared<test::reaver::thread_pool>(1);
+    test::reaver::shared_configuration<> config;
+
+    std::mutex lock;
+    std::vector<int> simple_values;
+    std::vector<int> another_values;
+
+    auto simple = config.on_change<simple_tag>(pool, [&](int value) {
+        std::lock_guard<std::mutex> guard{ lock };
+        simple_values.push_back(value);
+    });
+    config.on_change<another_tag>(pool, [&](int value) {
+        std::lock_guard<std::mutex> guard{ lock };
+        another_values.push_back(value);
+    });
+
+    config.update([](auto & c) {
+        c.template set<simple_tag>(1);
+        c.template set<simple_tag>(2);
+        c.template set<another_tag>(3);
+    });
+    config.set<another_tag>(4);
+
+    config.unsubscribe(simple);
+    config.set<simple_tag>(5);
+
+    pool->push([] {}).get();
+
+    std::lock_guard<std::mutex> guard{ lock };
+    MAYFLY_CHECK(simple_values == std::vector<int>{ 2 });
+    MAYFLY_CHECK(another_values == (std::vector<int>{ 3, 4 }));
+});
+
 MAYFLY_END_SUITE;
 MAYFLY_END_SUITE;
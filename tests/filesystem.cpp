@@ -22,7 +22,99 @@
 
 #include <reaver/mayfly.h>
 
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
 #include "filesystem.h"
+#include "thread_pool.h"
+
+namespace
+{
+struct temporary_tree
+{
+    temporary_tree(std::initializer_list<const char *> files) : root{ boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() }
+    {
+        for (auto && file : files)
+        {
+            boost::filesystem::create_directories((root / file).parent_path());
+            std::ofstream{ (root / file).string() };
+        }
+    }
+
+    ~temporary_tree()
+    {
+        boost::filesystem::remove_all(root);
+    }
+
+    boost::filesystem::path root;
+};
+
+std::set<std::string> parallel_wildcard(const std::string & pattern, const boost::filesystem::path & base)
+{
+    auto pool = std::make_shared<reaver::thread_pool>(4);
+
+    std::mutex lock;
+    std::set<std::string> matches;
+
+    auto future = reaver::filesystem::wildcard(pool, pattern, base, [&](boost::filesystem::path path) {
+        std::lock_guard<std::mutex> guard{ lock };
+        matches.insert(path.string());
+    });
+
+    while (!future.try_get())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return matches;
+}
+
+// the number of inotify watches of this process, as reported in /proc
+std::size_t inotify_watches()
+{
+    std::size_t ret = 0;
+
+    for (auto && fd : boost::filesystem::directory_iterator{ "/proc/self/fd" })
+    {
+        boost::system::error_code error;
+        if (boost::filesystem::read_symlink(fd.path(), error) != "anon_inode:inotify")
+        {
+            continue;
+        }
+
+        std::ifstream info{ "/proc/self/fdinfo/" + fd.path().filename().string() };
+        std::string line;
+        while (std::getline(info, line))
+        {
+            ret += line.compare(0, 11, "inotify wd:") == 0;
+        }
+    }
+
+    return ret;
+}
+
+struct inline_executor : reaver::executor
+{
+    void push(reaver::unique_function<void()> f) override
+    {
+        f();
+    }
+};
+
+// an executor that is shutting down
+struct refusing_executor : reaver::executor
+{
+    void push(reaver::unique_function<void()>) override
+    {
+        throw std::runtime_error{ "the executor is shutting down" };
+    }
+};
+}
 
 MAYFLY_BEGIN_SUITE("filesystem");
 
@@ -31,6 +123,166 @@ MAYFLY_ADD_TESTCASE("make_relative", [] {
     MAYFLY_CHECK(reaver::filesystem::make_relative("/foo/bar/biz", "/foo/bar/baz") == "../biz");
     MAYFLY_CHECK(reaver::filesystem::make_relative("/foo/bar/baz/buzz", "/foo/bar") == "baz/buzz");
     MAYFLY_CHECK(reaver::filesystem::make_relative("/foo/bar", "/foo/bar") == "");
+    MAYFLY_CHECK(reaver::filesystem::make_relative("/foo//bar/./baz/", "/foo/bar/") == "baz");
+    MAYFLY_CHECK(reaver::filesystem::make_relative("/", "/foo/bar") == "../..");
+})
+
+MAYFLY_ADD_TESTCASE("relative base", [] {
+    reaver::filesystem::relative_base base{ "/foo/bar" };
+    MAYFLY_CHECK(base.path() == "/foo/bar");
+    MAYFLY_CHECK(base.relative("/foo/bar/baz/buzz") == "baz/buzz");
+    MAYFLY_CHECK(base.relative("/foo/biz") == "../biz");
+    MAYFLY_CHECK(base.relative("/foo/bar") == "");
+
+    std::string out = "prefix:";
+    base.relative("/foo/bar/x", out);
+    MAYFLY_CHECK(out == "prefix:x");
+
+    auto copy = base;
+    MAYFLY_CHECK(copy.relative("/foo/bar/baz") == "baz");
+
+    reaver::filesystem::relative_base cwd;
+    MAYFLY_CHECK(cwd.relative("a/b") == "a/b");
+    MAYFLY_CHECK(cwd.relative(boost::filesystem::current_path().string()) == "");
+})
+
+MAYFLY_ADD_TESTCASE("wildcard", [] {
+    temporary_tree tree{ "a/x.cpp", "a/y.h", "a/b/z.cpp", "a/b/c/w.cpp", "d/v.cpp" };
+
+    auto matches = [&](const std::string & pattern, const boost::filesystem::path & base) {
+        std::set<std::string> ret;
+        for (auto && path : reaver::filesystem::wildcard(pattern, base))
+        {
+            ret.insert(path.string());
+        }
+        return ret;
+    };
+
+    MAYFLY_CHECK(matches("*/*.cpp", tree.root) == (std::set<std::string>{ "a/x.cpp", "d/v.cpp" }));
+    MAYFLY_CHECK(matches("a/**/*.cpp", tree.root) == (std::set<std::string>{ "a/x.cpp", "a/b/z.cpp", "a/b/c/w.cpp" }));
+    MAYFLY_CHECK(matches("**", tree.root / "a" / "b") == (std::set<std::string>{ "", "z.cpp", "c", "c/w.cpp" }));
+    MAYFLY_CHECK(matches("a/?/z.*", tree.root) == (std::set<std::string>{ "a/b/z.cpp" }));
+    MAYFLY_CHECK(matches("a/nope/*", tree.root).empty());
+    MAYFLY_CHECK(matches("*", tree.root / "nope").empty());
+})
+
+MAYFLY_ADD_TESTCASE("cached wildcard", [] {
+    temporary_tree tree{ "a/x.cpp", "a/b/z.cpp", "d/v.cpp" };
+    reaver::filesystem::directory_cache cache;
+
+    auto matches = [&](const std::string & pattern) {
+        std::set<std::string> ret;
+        for (auto && path : reaver::filesystem::wildcard(pattern, tree.root, cache))
+        {
+            ret.insert(path.string());
+        }
+        return ret;
+    };
+
+    MAYFLY_CHECK(matches("**/*.cpp") == (std::set<std::string>{ "a/x.cpp", "a/b/z.cpp", "d/v.cpp" }));
+    MAYFLY_CHECK(matches("a/b/z.cpp") == (std::set<std::string>{ "a/b/z.cpp" }));
+
+    std::ofstream{ (tree.root / "a" / "b" / "y.cpp").string() };
+    boost::filesystem::remove_all(tree.root / "d");
+    MAYFLY_CHECK(matches("**/*.cpp") == (std::set<std::string>{ "a/x.cpp", "a/b/z.cpp", "a/b/y.cpp" }));
+
+    // a directory replaced with a different one under the same name must not be served from the old listing
+    boost::filesystem::rename(tree.root / "a" / "b", tree.root / "c");
+    boost::filesystem::create_directories(tree.root / "a" / "b");
+    std::ofstream{ (tree.root / "a" / "b" / "w.cpp").string() };
+    MAYFLY_CHECK(matches("**/*.cpp") == (std::set<std::string>{ "a/x.cpp", "a/b/w.cpp", "c/z.cpp", "c/y.cpp" }));
+    MAYFLY_CHECK(matches("a/b/z.cpp").empty());
+})
+
+MAYFLY_ADD_TESTCASE("directory cache watches", [] {
+    temporary_tree tree{ "a/x.cpp", "a/b/z.cpp", "d/v.cpp" };
+    reaver::filesystem::directory_cache cache;
+
+    auto a = (tree.root / "a").string();
+    auto b = (tree.root / "a" / "b").string();
+    auto d = (tree.root / "d").string();
+
+    MAYFLY_CHECK(cache.list(a)->size() == 2);
+    MAYFLY_CHECK(cache.list(b)->size() == 1);
+    MAYFLY_CHECK(cache.list(d)->size() == 1);
+    MAYFLY_CHECK(inotify_watches() == 3);
+
+    // a change drops the listing, and its watch goes away with it until it's listed again
+    std::ofstream{ (tree.root / "a" / "y.cpp").string() };
+    cache.refresh();
+    MAYFLY_CHECK(inotify_watches() == 2);
+
+    MAYFLY_CHECK(cache.list(a)->size() == 3);
+    MAYFLY_CHECK(inotify_watches() == 3);
+
+    // so do the watches of everything cached below a directory that was moved away
+    boost::filesystem::rename(tree.root / "a", tree.root / "c");
+    cache.refresh();
+    MAYFLY_CHECK(inotify_watches() == 1);
+
+    cache.clear();
+    MAYFLY_CHECK(inotify_watches() == 0);
+
+    // when a directory can't be watched, it's read anyway, and that reports the error
+    MAYFLY_CHECK(cache.list(d)->find("v.cpp") == reaver::filesystem::entry_type::regular);
+    MAYFLY_CHECK_THROWS_TYPE(boost::filesystem::filesystem_error, cache.list((tree.root / "nope").string()));
+    MAYFLY_CHECK(inotify_watches() == 1);
+})
+
+MAYFLY_ADD_TESTCASE("walk", [] {
+    temporary_tree tree{ "a/x.cpp", "a/b/z.cpp", "d/v.cpp" };
+
+    std::set<std::string> entries;
+    std::set<std::string> directories;
+    reaver::filesystem::walk(tree.root, [&](std::string_view path, reaver::filesystem::entry_type type) {
+        entries.emplace(path);
+        if (type == reaver::filesystem::entry_type::directory)
+        {
+            directories.emplace(path);
+        }
+        return path != "d";
+    });
+
+    MAYFLY_CHECK(entries == (std::set<std::string>{ "a", "a/x.cpp", "a/b", "a/b/z.cpp", "d" }));
+    MAYFLY_CHECK(directories == (std::set<std::string>{ "a", "a/b", "d" }));
+})
+
+MAYFLY_ADD_TESTCASE("parallel wildcard", [] {
+    temporary_tree tree{ "a/x.cpp", "a/y.h", "a/b/z.cpp", "a/b/c/w.cpp", "d/v.cpp" };
+
+    MAYFLY_CHECK(parallel_wildcard("*/*.cpp", tree.root) == (std::set<std::string>{ "a/x.cpp", "d/v.cpp" }));
+    MAYFLY_CHECK(parallel_wildcard("a/**/*.cpp", tree.root) == (std::set<std::string>{ "a/x.cpp", "a/b/z.cpp", "a/b/c/w.cpp" }));
+    MAYFLY_CHECK(parallel_wildcard("**", tree.root / "a" / "b") == (std::set<std::string>{ "", "z.cpp", "c", "c/w.cpp" }));
+    MAYFLY_CHECK(parallel_wildcard("a/b/z.cpp", tree.root) == (std::set<std::string>{ "a/b/z.cpp" }));
+    MAYFLY_CHECK(parallel_wildcard("a/nope/*", tree.root).empty());
+
+    auto absolute = (tree.root / "d").string() + "/*.cpp";
+    MAYFLY_CHECK(parallel_wildcard(absolute, "/nonexistent") == (std::set<std::string>{ (tree.root / "d" / "v.cpp").string() }));
+})
+
+MAYFLY_ADD_TESTCASE("parallel wildcard errors with an inline executor", [] {
+    temporary_tree tree{ "a/x.cpp", "d/v.cpp" };
+    auto sched = std::make_shared<inline_executor>();
+
+    std::set<std::string> matches;
+    auto future = reaver::filesystem::wildcard(sched, "*/*", tree.root, [&](boost::filesystem::path path) {
+        matches.insert(path.string());
+        // whichever directory is listed first removes the other one before it's listed
+        boost::filesystem::remove_all(tree.root / (path.string()[0] == 'a' ? "d" : "a"));
+    });
+
+    MAYFLY_CHECK(matches.size() == 1);
+    MAYFLY_CHECK_THROWS_TYPE(boost::filesystem::filesystem_error, future.try_get());
+
+    auto ok = reaver::filesystem::wildcard(sched, "*/*", tree.root, [&](boost::filesystem::path) {});
+    MAYFLY_CHECK(ok.try_get());
+})
+
+MAYFLY_ADD_TESTCASE("parallel wildcard with an executor that refuses tasks", [] {
+    temporary_tree tree{ "a/x.cpp", "d/v.cpp" };
+
+    auto future = reaver::filesystem::wildcard(std::make_shared<refusing_executor>(), "*/*", tree.root, [&](boost::filesystem::path) {});
+    MAYFLY_CHECK_THROWS_TYPE(std::runtime_error, future.try_get());
 })
 
 MAYFLY_END_SUITE;
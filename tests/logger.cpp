@@ -22,10 +22,25 @@
 
 #include <reaver/mayfly.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <streambuf>
+#include <thread>
+#include <utility>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <boost/functional/hash.hpp>
 namespace test
 {
 #include "logger.h"
+#include "logger/crash.h"
 }
 
 #include <sstream>
@@ -45,4 +60,427 @@ MAYFLY_ADD_TESTCASE("basic printing to stringstream", [] {
     MAYFLY_REQUIRE(stream.str() == "hello world! 1false\n");
 });
 
+MAYFLY_ADD_TESTCASE("level prefixes", [] {
+    std::ostringstream stream;
+
+    {
+        test::reaver::logger::logger logger{ test::reaver::logger::trace };
+        logger.add_stream(stream);
+
+        logger(test::reaver::logger::error) << "first";
+        logger(test::reaver::logger::trace) << "second";
+        logger(test::reaver::logger::always) << "third";
+    }
+
+    MAYFLY_REQUIRE(stream.str() == "Error: first\nTrace: second\nthird\n");
+});
+
+MAYFLY_ADD_TESTCASE("rate limited call site", [] {
+    std::ostringstream stream;
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+
+        test::reaver::logger::call_site site{ test::reaver::logger::rate_limit{ 1, 2 } };
+        for (auto i = 0; i < 10; ++i)
+        {
+            logger(test::reaver::logger::always, site) << i;
+        }
+    }
+
+    MAYFLY_REQUIRE(stream.str() == "0\n1\n");
+});
+
+MAYFLY_ADD_TESTCASE("degenerate rate limits", [] {
+    std::ostringstream stream;
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+
+        test::reaver::logger::call_site zero{ test::reaver::logger::rate_limit{ 0 } };
+        test::reaver::logger::call_site negative{ test::reaver::logger::rate_limit{ -1 } };
+        test::reaver::logger::call_site tiny{ test::reaver::logger::rate_limit{ 1e-30, 1000 } };
+        test::reaver::logger::call_site huge_burst{ test::reaver::logger::rate_limit{ 1, std::numeric_limits<std::size_t>::max() } };
+        for (auto i = 0; i < 2; ++i)
+        {
+            logger(test::reaver::logger::always, zero) << "zero";
+            logger(test::reaver::logger::always, negative) << "negative";
+            logger(test::reaver::logger::always, tiny) << "tiny";
+            logger(test::reaver::logger::always, huge_burst) << "burst";
+        }
+    }
+
+    MAYFLY_REQUIRE(stream.str() == "tiny\nburst\ntiny\nburst\n");
+});
+
+MAYFLY_ADD_TESTCASE("suppressed messages summary", [] {
+    std::ostringstream stream;
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+
+        test::reaver::logger::call_site site{ test::reaver::logger::rate_limit{ 10 } };
+        for (auto i = 0; i < 3; ++i)
+        {
+            logger(test::reaver::logger::always, site) << i;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        logger(test::reaver::logger::always, site) << "again";
+    }
+
+    MAYFLY_REQUIRE(stream.str() == "0\nagain\nsuppressed 2 messages\n");
+});
+
+MAYFLY_ADD_TESTCASE("sampled call site", [] {
+    std::ostringstream stream;
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+
+        test::reaver::logger::call_site never{ test::reaver::logger::sampling{ 0 } };
+        test::reaver::logger::call_site always{ test::reaver::logger::sampling{ 1 } };
+        for (auto i = 0; i < 10; ++i)
+        {
+            logger(test::reaver::logger::always, never) << "never";
+        }
+        logger(test::reaver::logger::always, always) << "always";
+    }
+
+    MAYFLY_REQUIRE(stream.str() == "always\n");
+});
+
+MAYFLY_ADD_TESTCASE("summary of an always suppressed call site", [] {
+    std::ostringstream stream;
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+
+        test::reaver::logger::call_site never{ test::reaver::logger::sampling{ 0 }, test::reaver::logger::summary_interval{ std::chrono::milliseconds(50) } };
+        for (auto i = 0; i < 3; ++i)
+        {
+            logger(test::reaver::logger::always, never) << "never";
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        logger(test::reaver::logger::always, never) << "never";
+
+        // a summary is only checked for when the site is reached, so this one is never reported
+        logger(test::reaver::logger::always, never) << "never";
+    }
+
+    MAYFLY_REQUIRE(stream.str() == "suppressed 4 messages\n");
+});
+
+MAYFLY_ADD_TESTCASE("multiple streams", [] {
+    std::ostringstream first;
+    std::ostringstream second;
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(first);
+        logger.add_stream(second);
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            logger() << i;
+        }
+
+        logger.sync();
+        MAYFLY_REQUIRE(first.str() == second.str());
+    }
+
+    std::string expected;
+    for (auto i = 0; i < 100; ++i)
+    {
+        expected += std::to_string(i) + "\n";
+    }
+
+    MAYFLY_REQUIRE(first.str() == expected);
+    MAYFLY_REQUIRE(second.str() == expected);
+});
+
+MAYFLY_ADD_TESTCASE("statistics", [] {
+    std::ostringstream stream;
+
+    test::reaver::logger::logger logger;
+    logger.add_stream(stream);
+
+    for (auto i = 0; i < 10; ++i)
+    {
+        logger() << "0123456789";
+    }
+
+    logger.sync();
+
+    auto stats = logger.statistics();
+    MAYFLY_CHECK(stats.queue_depth == 0);
+    MAYFLY_CHECK(stats.records_written == 10);
+    MAYFLY_CHECK(stats.bytes_written == 110);
+    MAYFLY_CHECK(stats.dropped_records == 0);
+
+    std::uint64_t lags = 0;
+    for (auto bucket : stats.lag_histogram)
+    {
+        lags += bucket;
+    }
+    MAYFLY_CHECK(lags == 10);
+});
+
+MAYFLY_ADD_TESTCASE("overflow policies", [] {
+    {
+        std::ostringstream stream;
+
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+        logger.set_overflow_policy(test::reaver::logger::overflow_policy::drop, 1);
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            logger() << i;
+        }
+
+        logger.sync();
+
+        auto stats = logger.statistics();
+        auto output = stream.str();
+        MAYFLY_CHECK(stats.records_written + stats.dropped_records == 1000);
+        MAYFLY_CHECK(static_cast<std::uint64_t>(std::count(output.begin(), output.end(), '\n')) == stats.records_written);
+    }
+
+    {
+        std::ostringstream stream;
+
+        test::reaver::logger::logger logger;
+        logger.add_stream(stream);
+        logger.set_overflow_policy(test::reaver::logger::overflow_policy::block, 1);
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            logger() << i;
+        }
+
+        logger.sync();
+
+        auto stats = logger.statistics();
+        MAYFLY_CHECK(stats.records_written == 1000);
+        MAYFLY_CHECK(stats.dropped_records == 0);
+    }
+});
+
+// a producer blocked on a slow stream must not keep the logger from being used otherwise
+MAYFLY_ADD_TESTCASE("blocked producer", [] {
+    MAYFLY_MAIN_THREAD;
+
+    // a stream that doesn't finish a write until it's opened
+    struct gated_buffer : std::streambuf
+    {
+        virtual int_type overflow(int_type ch) override
+        {
+            wait();
+            return ch;
+        }
+
+        virtual std::streamsize xsputn(const char *, std::streamsize size) override
+        {
+            wait();
+            return size;
+        }
+
+        void wait()
+        {
+            while (!open)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        std::atomic<bool> open{ false };
+    };
+
+    gated_buffer buffer;
+    std::ostream gated{ &buffer };
+    std::ostringstream other;
+
+    std::atomic<bool> added{ false };
+    std::atomic<bool> timed_out{ false };
+
+    {
+        test::reaver::logger::logger logger;
+        logger.add_stream(gated);
+        logger.set_overflow_policy(test::reaver::logger::overflow_policy::block, 1);
+
+        std::thread producer{ [&] {
+            MAYFLY_THREAD;
+
+            for (auto i = 0; i < 5; ++i)
+            {
+                logger() << i;
+            }
+        } };
+
+        // opens the stream anyway if the logger is stuck, so that the test fails instead of hanging
+        std::thread watchdog{ [&] {
+            for (auto i = 0; i < 5000 && !added; ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if (!added)
+            {
+                timed_out = true;
+                buffer.open = true;
+            }
+        } };
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        logger.add_stream(other);
+        added = true;
+
+        watchdog.join();
+        buffer.open = true;
+        producer.join();
+        logger.sync();
+    }
+
+    MAYFLY_CHECK(!timed_out);
+});
+
+namespace
+{
+// runs crash() in a child process, with a logger that has two records queued for a stream that is stuck; returns what
+// the crash handlers flushed, and the status of the child
+template<typename F>
+std::pair<std::string, int> crash_with_queued_records(F crash)
+{
+    int fds[2];
+    MAYFLY_REQUIRE(pipe(fds) == 0);
+
+    auto child = fork();
+    MAYFLY_REQUIRE(child >= 0);
+
+    if (child == 0)
+    {
+        close(fds[0]);
+
+        // a stream that never finishes a write, so that the records stay queued
+        struct stuck_buffer : std::streambuf
+        {
+            virtual int_type overflow(int_type ch) override
+            {
+                return stall();
+            }
+
+            virtual std::streamsize xsputn(const char *, std::streamsize) override
+            {
+                return stall();
+            }
+
+            int stall()
+            {
+                while (true)
+                {
+                    pause();
+                }
+            }
+        };
+
+        static stuck_buffer buffer;
+        static std::ostream stuck{ &buffer };
+
+        auto logger = new test::reaver::logger::logger;
+        logger->enable_crash_flush();
+        logger->add_stream({ stuck, fds[1] });
+        test::reaver::logger::install_crash_handlers();
+
+        (*logger)(test::reaver::logger::error) << "first";
+        (*logger)() << "second";
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        crash();
+        std::_Exit(0);
+    }
+
+    close(fds[1]);
+
+    std::string output;
+    char buffer[256];
+    ssize_t size;
+    while ((size = read(fds[0], buffer, sizeof(buffer))) > 0)
+    {
+        output.append(buffer, size);
+    }
+    close(fds[0]);
+
+    int status;
+    waitpid(child, &status, 0);
+
+    return { output, status };
+}
+
+volatile std::size_t stack_limit = std::numeric_limits<std::size_t>::max();
+
+// recurses until the stack runs out; the result of every call is used, so that the calls can't be turned into a loop
+std::size_t overflow_stack(std::size_t depth)
+{
+    volatile char frame[1024];
+    frame[0] = static_cast<char>(depth);
+
+    if (depth == stack_limit)
+    {
+        return 0;
+    }
+
+    return overflow_stack(depth + 1) + frame[0];
+}
+}
+
+MAYFLY_ADD_TESTCASE("emergency flush", [] {
+    auto [output, status] = crash_with_queued_records([] { std::abort(); });
+
+    MAYFLY_CHECK(WIFSIGNALED(status));
+    MAYFLY_CHECK(WTERMSIG(status) == SIGABRT);
+    MAYFLY_CHECK(output == "Error: first\nsecond\n");
+});
+
+// the handler runs on an alternate stack, so that it still works when the stack is exhausted
+MAYFLY_ADD_TESTCASE("emergency flush after a stack overflow", [] {
+    auto [output, status] = crash_with_queued_records([] { overflow_stack(0); });
+
+    MAYFLY_CHECK(WIFSIGNALED(status));
+    MAYFLY_CHECK(WTERMSIG(status) == SIGSEGV);
+    MAYFLY_CHECK(output == "Error: first\nsecond\n");
+});
+
+MAYFLY_ADD_TESTCASE("crash buffer wraps around", [] {
+    using namespace test::reaver::logger;
+
+    _detail::_crash_buffer buffer{ 2 };
+    buffer.add_stream(42);
+
+    std::vector<std::uint64_t> tickets;
+    for (auto && text : { "first", "second", "third" })
+    {
+        tickets.push_back(buffer.publish(base_level::info, { streamable{ std::string{ text } + "\n" } }));
+    }
+
+    MAYFLY_CHECK(std::count(tickets.begin(), tickets.end(), 0) == 0);
+
+    // releasing a record that was already overwritten must not touch the one that took its slot
+    buffer.release(tickets[0], 0);
+
+    std::string output;
+    buffer.drain([&](int fd, const char * data, std::size_t size) {
+        MAYFLY_CHECK(fd == 42);
+        output.append(data, size);
+    });
+
+    MAYFLY_CHECK(output == "Info: second\nInfo: third\n");
+});
+
 MAYFLY_END_SUITE;
@@ -0,0 +1,127 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <reaver/mayfly.h>
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "mapped_file.h"
+
+namespace
+{
+struct temporary_file
+{
+    temporary_file(const std::string & contents) : path{ (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string() }
+    {
+        std::ofstream{ path, std::ios::binary } << contents;
+    }
+
+    ~temporary_file()
+    {
+        boost::filesystem::remove(path);
+    }
+
+    std::string path;
+};
+
+std::string pattern(std::size_t size)
+{
+    std::string ret;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        ret.push_back(static_cast<char>('a' + i % 26));
+    }
+    return ret;
+}
+}
+
+MAYFLY_BEGIN_SUITE("mapped file");
+
+MAYFLY_ADD_TESTCASE("contents", [] {
+    temporary_file file{ "hello, world" };
+    reaver::mapped_file mapped{ file.path, { reaver::access_pattern::random, true, true } };
+
+    MAYFLY_CHECK(mapped.size() == 12);
+    MAYFLY_CHECK(mapped.contents() == "hello, world");
+    MAYFLY_CHECK(mapped.subspan(7) == "world");
+    MAYFLY_CHECK(mapped.subspan(0, 5) == "hello");
+    MAYFLY_CHECK(mapped[4] == 'o');
+    MAYFLY_CHECK(std::string(mapped.begin(), mapped.end()) == "hello, world");
+
+    auto moved = std::move(mapped);
+    MAYFLY_CHECK(moved.contents() == "hello, world");
+    MAYFLY_CHECK(mapped.empty());
+
+    temporary_file empty{ "" };
+    MAYFLY_CHECK(reaver::mapped_file{ empty.path }.empty());
+});
+
+MAYFLY_ADD_TESTCASE("errors", [] {
+    MAYFLY_CHECK_THROWS_TYPE(reaver::file_not_found, reaver::mapped_file{ "/nonexistent/file" });
+    MAYFLY_CHECK_THROWS_TYPE(reaver::file_is_directory, reaver::mapped_file{ boost::filesystem::temp_directory_path().string() });
+    MAYFLY_CHECK_THROWS_TYPE(reaver::file_not_found, reaver::chunked_file_reader{ "/nonexistent/file" });
+});
+
+MAYFLY_ADD_TESTCASE("chunked reader", [] {
+    auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto contents = pattern(page_size * 3 + page_size / 2);
+    temporary_file file{ contents };
+
+    reaver::chunked_file_reader reader{ file.path, page_size };
+
+    std::string read;
+    std::size_t chunks = 0;
+    for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next())
+    {
+        MAYFLY_CHECK(reader.offset() == read.size());
+        MAYFLY_CHECK(chunk.size() <= page_size);
+        read.append(chunk);
+        ++chunks;
+    }
+
+    MAYFLY_CHECK(chunks == 4);
+    MAYFLY_CHECK(read == contents);
+    MAYFLY_CHECK(reader.next().empty());
+});
+
+MAYFLY_ADD_TESTCASE("chunked reader over a pipe", [] {
+    int fds[2];
+    MAYFLY_REQUIRE(::pipe(fds) == 0);
+    MAYFLY_REQUIRE(::write(fds[1], "streamed", 8) == 8);
+    ::close(fds[1]);
+
+    reaver::chunked_file_reader reader{ "/proc/self/fd/" + std::to_string(fds[0]), 3 };
+
+    std::string read;
+    for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next())
+    {
+        read.append(chunk);
+    }
+
+    ::close(fds[0]);
+    MAYFLY_CHECK(read == "streamed");
+});
+
+MAYFLY_END_SUITE;
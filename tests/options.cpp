@@ -22,14 +22,27 @@
 
 #include <reaver/mayfly.h>
 
+#include <charconv>
+#include <cstdio>
 #include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <boost/functional/hash.hpp>
 #include <boost/program_options.hpp>
 
 namespace test
 {
+#include "configuration/argv.h"
+#include "configuration/file.h"
 #include "configuration/options.h"
+#include "configuration/sources.h"
 }
 
 namespace
@@ -79,6 +92,43 @@ struct path : test::reaver::options::opt<path, std::vector<std::string>>
 {
     static constexpr const char * name = "path";
 };
+
+struct search_path : test::reaver::options::opt<search_path, std::vector<std::string>>
+{
+    static constexpr const char * name = "search-path";
+
+    static std::vector<std::string> default_value()
+    {
+        return { "default" };
+    }
+};
+
+struct single_path : test::reaver::options::opt<single_path, std::vector<std::string>>
+{
+    static constexpr const char * name = "single-path";
+    static constexpr test::reaver::options::option_set options = [] {
+        test::reaver::options::option_set options;
+        options.allows_composing = false;
+        return options;
+    }();
+};
+
+struct port : test::reaver::options::opt<port, std::uint16_t>
+{
+    static constexpr const char * name = "server.port";
+    static constexpr std::uint16_t default_value = 80;
+};
+
+struct ratio : test::reaver::options::opt<ratio, double>
+{
+    static constexpr const char * name = "ratio";
+};
+
+struct threads : test::reaver::options::opt<threads, int>
+{
+    static constexpr const char * name = "threads";
+    static constexpr const char * env = "THREAD_COUNT";
+};
 }
 
 MAYFLY_BEGIN_SUITE("configuration");
@@ -181,5 +231,232 @@ MAYFLY_ADD_TESTCASE("mixed arguments", [] {
 // TODO: tests regarding tag::parsed_type
 // TODO: tests regarding tag::default_value
 
+MAYFLY_END_SUITE;
+
+MAYFLY_BEGIN_SUITE("file");
+
+MAYFLY_ADD_TESTCASE("parsing", [] {
+    auto parsed = test::reaver::options::parse_config(
+        "# a comment\n"
+        "count = 5\n"
+        "output = \"foo \\\"bar\\\"\" ; another comment\n"
+        "version = yes\n"
+        "path = a\n"
+        "path = b # not a part of the value\n"
+        "\n"
+        "[server]\n"
+        "port = 8080\r\n",
+        test::reaver::id<count>{},
+        test::reaver::id<output>{},
+        test::reaver::id<version>{},
+        test::reaver::id<path>{},
+        test::reaver::id<port>{},
+        test::reaver::id<optional>{});
+
+    MAYFLY_CHECK(parsed.get<count>() == 5);
+    MAYFLY_CHECK(parsed.get<output>() == "foo \"bar\"");
+    MAYFLY_CHECK(parsed.get<version>());
+    MAYFLY_CHECK(parsed.get<path>() == std::vector<std::string>{ "a", "b" });
+    MAYFLY_CHECK(parsed.get<port>() == 8080);
+    MAYFLY_CHECK(!parsed.get<optional>());
+});
+
+MAYFLY_ADD_TESTCASE("defaults", [] {
+    auto parsed = test::reaver::options::parse_config("ratio = 0.25", test::reaver::id<port>{}, test::reaver::id<ratio>{});
+    MAYFLY_CHECK(parsed.get<port>() == 80);
+    MAYFLY_CHECK(parsed.get<ratio>() == 0.25);
+
+    auto paths = test::reaver::options::parse_config("search-path = a\nsearch-path = b", test::reaver::id<search_path>{});
+    MAYFLY_CHECK(paths.get<search_path>() == std::vector<std::string>{ "a", "b" });
+});
+
+MAYFLY_ADD_TESTCASE("errors", [] {
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::config_file_error, test::reaver::options::parse_config("foo = 1", test::reaver::id<count>{}));
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::config_file_error, test::reaver::options::parse_config("count = x", test::reaver::id<count>{}));
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::config_file_error, test::reaver::options::parse_config("count", test::reaver::id<count>{}));
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::config_file_error, test::reaver::options::parse_config("[server", test::reaver::id<port>{}));
+    MAYFLY_CHECK_THROWS_TYPE(
+        test::reaver::options::config_file_error, test::reaver::options::parse_config("output = \"foo", test::reaver::id<output>{}));
+    MAYFLY_CHECK_THROWS_TYPE(
+        test::reaver::options::config_file_error, test::reaver::options::parse_config("[server]\nport = 65536", test::reaver::id<port>{}));
+});
+
+MAYFLY_ADD_TESTCASE("mapped file", [] {
+    char name[] = "/tmp/reaver-config-XXXXXX";
+    auto fd = mkstemp(name);
+    MAYFLY_REQUIRE(fd >= 0);
+
+    std::string_view contents = "count = 3\n[server]\nport = 1234\n";
+    MAYFLY_REQUIRE(write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size()));
+    close(fd);
+
+    auto parsed = test::reaver::options::parse_config_file(name, test::reaver::id<count>{}, test::reaver::id<port>{});
+    unlink(name);
+
+    MAYFLY_CHECK(parsed.get<count>() == 3);
+    MAYFLY_CHECK(parsed.get<port>() == 1234);
+
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::config_file_open_error, test::reaver::options::parse_config_file(name, test::reaver::id<count>{}));
+});
+
+MAYFLY_END_SUITE;
+
+MAYFLY_BEGIN_SUITE("static argv");
+
+MAYFLY_ADD_TESTCASE("regular and void", [] {
+    const char * argv[] = { "", "--count", "2", "--output=foo", "--version" };
+    auto parsed = test::reaver::options::static_parse_argv(
+        5, argv, test::reaver::id<count>{}, test::reaver::id<output>{}, test::reaver::id<version>{}, test::reaver::id<help>{});
+    MAYFLY_REQUIRE(std::is_same<decltype(parsed), test::reaver::static_configuration<count, output, version, help>>::value);
+    MAYFLY_CHECK(parsed.get<count>() == 2);
+    MAYFLY_CHECK(parsed.get<output>() == "foo");
+    MAYFLY_CHECK(parsed.get<version>());
+    MAYFLY_CHECK(!parsed.get<help>());
+});
+
+MAYFLY_ADD_TESTCASE("short forms", [] {
+    const char * argv[] = { "", "-vhc5", "-o", "foo", "-other-void" };
+    auto parsed = test::reaver::options::static_parse_argv(5,
+        argv,
+        test::reaver::id<count>{},
+        test::reaver::id<output>{},
+        test::reaver::id<version>{},
+        test::reaver::id<help>{},
+        test::reaver::id<other_void>{});
+    MAYFLY_CHECK(parsed.get<count>() == 5);
+    MAYFLY_CHECK(parsed.get<output>() == "foo");
+    MAYFLY_CHECK(parsed.get<version>());
+    MAYFLY_CHECK(parsed.get<help>());
+    MAYFLY_CHECK(parsed.get<other_void>());
+});
+
+MAYFLY_ADD_TESTCASE("positional, optional and vector", [] {
+    const char * argv[] = { "", "upgrade", "--path", "a", "--optional", "3", "--path=b", "--", "456" };
+    auto parsed = test::reaver::options::static_parse_argv(9,
+        argv,
+        test::reaver::id<value>{},
+        test::reaver::id<command>{},
+        test::reaver::id<optional>{},
+        test::reaver::id<path>{},
+        test::reaver::id<port>{});
+    MAYFLY_CHECK(parsed.get<command>() == "upgrade");
+    MAYFLY_CHECK(parsed.get<value>() == 456);
+    MAYFLY_CHECK(parsed.get<optional>() == 3);
+    MAYFLY_CHECK(parsed.get<path>() == std::vector<std::string>{ "a", "b" });
+    MAYFLY_CHECK(parsed.get<port>() == 80);
+});
+
+MAYFLY_ADD_TESTCASE("vector defaults", [] {
+    const char * argv[] = { "", "--search-path", "a", "--single-path", "b", "--search-path=c", "--single-path=d" };
+    auto parsed = test::reaver::options::static_parse_argv(7, argv, test::reaver::id<search_path>{}, test::reaver::id<single_path>{});
+    MAYFLY_CHECK(parsed.get<search_path>() == std::vector<std::string>{ "a", "c" });
+    MAYFLY_CHECK(parsed.get<single_path>() == std::vector<std::string>{ "d" });
+
+    auto defaults = test::reaver::options::static_parse_argv(1, argv, test::reaver::id<search_path>{});
+    MAYFLY_CHECK(defaults.get<search_path>() == std::vector<std::string>{ "default" });
+});
+
+MAYFLY_ADD_TESTCASE("errors", [] {
+    {
+        const char * argv[] = { "", "--unknown" };
+        MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::unknown_option, test::reaver::options::static_parse_argv(2, argv, test::reaver::id<version>{}));
+    }
+
+    {
+        const char * argv[] = { "", "--count" };
+        MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::missing_option_value, test::reaver::options::static_parse_argv(2, argv, test::reaver::id<count>{}));
+    }
+
+    {
+        const char * argv[] = { "", "--count", "x" };
+        MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::invalid_option_value, test::reaver::options::static_parse_argv(3, argv, test::reaver::id<count>{}));
+    }
+
+    {
+        const char * argv[] = { "" };
+        MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::missing_option, test::reaver::options::static_parse_argv(1, argv, test::reaver::id<count>{}));
+    }
+
+    {
+        const char * argv[] = { "", "install", "extra" };
+        MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::unexpected_argument, test::reaver::options::static_parse_argv(3, argv, test::reaver::id<command>{}));
+    }
+});
+
+MAYFLY_END_SUITE;
+
+MAYFLY_BEGIN_SUITE("sources");
+
+MAYFLY_ADD_TESTCASE("precedence", [] {
+    char name[] = "/tmp/reaver-config-XXXXXX";
+    auto fd = mkstemp(name);
+    MAYFLY_REQUIRE(fd >= 0);
+
+    std::string_view contents = "count = 1\noutput = file\nratio = 0.5\npath = c\n[server]\nport = 1\n";
+    MAYFLY_REQUIRE(write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size()));
+    close(fd);
+
+    const char * argv[] = { "", "--count", "3", "--path", "a", "--path", "b" };
+    const char * environment[] = { "APP_COUNT=2", "APP_OUTPUT=env", "APP_SERVER_PORT=2", "THREAD_COUNT=4", "APP_THREADS=5", "UNRELATED=x", nullptr };
+
+    test::reaver::options::option_sources sources;
+    sources.argc = 7;
+    sources.argv = argv;
+    sources.environment = environment;
+    sources.env_prefix = "APP_";
+    sources.config_file = name;
+
+    auto parsed = test::reaver::options::parse_options(sources,
+        test::reaver::id<count>{},
+        test::reaver::id<output>{},
+        test::reaver::id<ratio>{},
+        test::reaver::id<path>{},
+        test::reaver::id<port>{},
+        test::reaver::id<threads>{},
+        test::reaver::id<other_void>{});
+    unlink(name);
+
+    MAYFLY_CHECK(parsed.get<count>() == 3);
+    MAYFLY_CHECK(parsed.get<output>() == "env");
+    MAYFLY_CHECK(parsed.get<ratio>() == 0.5);
+    MAYFLY_CHECK(parsed.get<path>() == std::vector<std::string>{ "a", "b" });
+    MAYFLY_CHECK(parsed.get<port>() == 2);
+    MAYFLY_CHECK(parsed.get<threads>() == 4);
+    MAYFLY_CHECK(!parsed.get<other_void>());
+});
+
+// a vector set by a source replaces the default value, and isn't merged with the values of lower precedence sources
+MAYFLY_ADD_TESTCASE("vector defaults", [] {
+    const char * argv[] = { "", "--search-path", "a", "--search-path", "b" };
+    const char * environment[] = { "APP_SEARCH_PATH=c", "APP_SINGLE_PATH=d", nullptr };
+
+    test::reaver::options::option_sources sources;
+    sources.argc = 5;
+    sources.argv = argv;
+    sources.environment = environment;
+    sources.env_prefix = "APP_";
+
+    auto parsed = test::reaver::options::parse_options(sources, test::reaver::id<search_path>{}, test::reaver::id<single_path>{});
+    MAYFLY_CHECK(parsed.get<search_path>() == std::vector<std::string>{ "a", "b" });
+    MAYFLY_CHECK(parsed.get<single_path>() == std::vector<std::string>{ "d" });
+
+    sources.argv = nullptr;
+    auto from_environment = test::reaver::options::parse_options(sources, test::reaver::id<search_path>{});
+    MAYFLY_CHECK(from_environment.get<search_path>() == std::vector<std::string>{ "c" });
+});
+
+MAYFLY_ADD_TESTCASE("errors", [] {
+    test::reaver::options::option_sources sources;
+
+    const char * invalid[] = { "APP_COUNT=x", nullptr };
+    sources.environment = invalid;
+    sources.env_prefix = "APP_";
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::invalid_option_value, test::reaver::options::parse_options(sources, test::reaver::id<count>{}));
+
+    const char * empty[] = { nullptr };
+    sources.environment = empty;
+    MAYFLY_CHECK_THROWS_TYPE(test::reaver::options::missing_option, test::reaver::options::parse_options(sources, test::reaver::id<count>{}));
+});
+
 MAYFLY_END_SUITE;
 MAYFLY_END_SUITE;
@@ -0,0 +1,239 @@
+/**
+ * Reaver Library Licence
+ *
+ * Copyright © 2026 Michał "Griwes" Dominiak
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation is required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ **/
+
+#include <reaver/mayfly.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "plugin.h"
+#include "thread_pool.h"
+
+namespace
+{
+template<typename T>
+auto wait(reaver::future<T> future)
+{
+    while (true)
+    {
+        if (auto value = future.try_get())
+        {
+            return *value;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// zlib's checksums are plain C functions with known results, so they're used to check calls that go through a plugin
+using checksum = unsigned long(unsigned long, const unsigned char *, unsigned);
+
+const unsigned char abc[] = { 'a', 'b', 'c' };
+constexpr unsigned long adler32_abc = 0x024d0127;
+constexpr unsigned long crc32_abc = 0x352441c2;
+
+struct adler32 : reaver::plugin_symbol<checksum>
+{
+    static constexpr const char name[] = "adler32";
+};
+
+struct crc32 : reaver::plugin_symbol<checksum>
+{
+    static constexpr const char name[] = "crc32";
+};
+
+struct version : reaver::plugin_symbol<const char *()>
+{
+    static constexpr const char name[] = "zlibVersion";
+};
+
+struct missing : reaver::plugin_symbol<void()>
+{
+    static constexpr const char name[] = "reaver_no_such_symbol";
+};
+}
+
+MAYFLY_BEGIN_SUITE("plugin");
+
+// the tests are linked against boost.filesystem anyway, so it's a library that is known to be there
+MAYFLY_ADD_TESTCASE("registry", [] {
+    reaver::plugin_registry registry;
+    MAYFLY_CHECK(!registry.find("boost_filesystem"));
+
+    auto first = registry.open("boost_filesystem", reaver::plugin_binding::eager);
+    auto second = registry.open("boost_filesystem");
+    MAYFLY_CHECK(first == second);
+    MAYFLY_CHECK(registry.find("boost_filesystem") == first);
+
+    MAYFLY_CHECK_THROWS_TYPE(reaver::library_not_found, registry.open("reaver_no_such_library"));
+    MAYFLY_CHECK_THROWS_TYPE(reaver::symbol_not_found, first->get_symbol<void()>("reaver_no_such_symbol"));
+});
+
+MAYFLY_ADD_TESTCASE("unload", [] {
+    reaver::plugin_registry registry;
+
+    auto plugin = registry.open("boost_filesystem");
+    auto unloaded = registry.unload("boost_filesystem");
+
+    MAYFLY_CHECK(!registry.find("boost_filesystem"));
+    MAYFLY_CHECK(!unloaded.try_get());
+
+    auto reopened = registry.open("boost_filesystem");
+    MAYFLY_CHECK(reopened != plugin);
+
+    plugin.reset();
+    MAYFLY_CHECK(unloaded.try_get());
+
+    MAYFLY_CHECK(registry.unload("reaver_no_such_library").try_get());
+});
+
+MAYFLY_ADD_TESTCASE("batch loading", [] {
+    reaver::plugin_registry registry;
+
+    auto futures = reaver::load_plugins(std::make_shared<reaver::thread_pool>(2),
+        { { "boost_filesystem" }, { "boost_filesystem" }, { "reaver_no_such_library" }, { "boost_filesystem", { "reaver_no_such_symbol" } } },
+        registry);
+    MAYFLY_REQUIRE(futures.size() == 4);
+
+    auto first = wait(std::move(futures[0]));
+    auto second = wait(std::move(futures[1]));
+    MAYFLY_CHECK(first.library == second.library);
+    MAYFLY_CHECK(first.library == registry.find("boost_filesystem"));
+    MAYFLY_CHECK(first.load_time.count() >= 0);
+
+    MAYFLY_CHECK_THROWS_TYPE(reaver::library_not_found, wait(std::move(futures[2])));
+    MAYFLY_CHECK_THROWS_TYPE(reaver::symbol_not_found, wait(std::move(futures[3])));
+});
+
+MAYFLY_ADD_TESTCASE("symbols", [] {
+    reaver::plugin_registry registry;
+    auto z = registry.open("z", reaver::plugin_binding::eager);
+
+    auto symbol = z->get_symbol<checksum>("adler32");
+    MAYFLY_REQUIRE(symbol);
+    MAYFLY_CHECK(z->get_symbol<checksum>("adler32") == symbol);
+    MAYFLY_CHECK(symbol(1, abc, 3) == adler32_abc);
+
+    reaver::plugin_function<checksum> function{ z, "adler32" };
+    MAYFLY_CHECK(function.get() == symbol);
+    MAYFLY_CHECK(function(1, abc, 3) == adler32_abc);
+
+    auto copy = function;
+    MAYFLY_CHECK(copy == function);
+    MAYFLY_CHECK(copy.get() == function.get());
+
+    MAYFLY_CHECK_THROWS_TYPE(reaver::symbol_not_found, (reaver::plugin_function<checksum>{ z, "reaver_no_such_symbol" }));
+});
+
+MAYFLY_ADD_TESTCASE("interface", [] {
+    reaver::plugin_registry registry;
+    auto z = registry.open("z");
+
+    reaver::plugin_interface<adler32, crc32, version> interface{ z };
+    MAYFLY_CHECK(interface.library() == z);
+
+    MAYFLY_CHECK(interface.get<adler32>() == z->get_symbol<checksum>("adler32"));
+    MAYFLY_CHECK(interface.get<crc32>() == z->get_symbol<checksum>("crc32"));
+    MAYFLY_CHECK(interface.get<adler32>()(1, abc, 3) == adler32_abc);
+
+    MAYFLY_CHECK(interface.call<adler32>(1, abc, 3) == adler32_abc);
+    MAYFLY_CHECK(interface.call<crc32>(0, abc, 3) == crc32_abc);
+    MAYFLY_CHECK(std::strlen(interface.call<version>()) > 0);
+
+    // every symbol is resolved up front, so a missing one is reported when the interface is created
+    MAYFLY_CHECK_THROWS_TYPE(reaver::symbol_not_found, (reaver::plugin_interface<adler32, missing>{ z }));
+});
+
+MAYFLY_ADD_TESTCASE("hot function", [] {
+    reaver::plugin_registry first_registry;
+    reaver::plugin_registry second_registry;
+    auto first = first_registry.open("z");
+    auto second = second_registry.open("z");
+
+    reaver::hot_plugin_function<checksum> adler32{ first, "adler32" };
+    MAYFLY_CHECK(adler32.name() == "adler32");
+    MAYFLY_CHECK(adler32.library() == first);
+    MAYFLY_CHECK(adler32(1, abc, 3) == adler32_abc);
+
+    adler32.reload(second);
+    MAYFLY_CHECK(adler32.library() == second);
+    MAYFLY_CHECK(adler32(1, abc, 3) == adler32_abc);
+
+    // a library without the symbol is rejected, and the old one stays in use
+    MAYFLY_CHECK_THROWS_TYPE(reaver::symbol_not_found, adler32.reload(first_registry.open("boost_filesystem")));
+    MAYFLY_CHECK(adler32.library() == second);
+    MAYFLY_CHECK(adler32(1, abc, 3) == adler32_abc);
+
+    MAYFLY_CHECK_THROWS_TYPE(reaver::symbol_not_found, (reaver::hot_plugin_function<checksum>{ first, "reaver_no_such_symbol" }));
+});
+
+MAYFLY_ADD_TESTCASE("hot function reloaded while called", [] {
+    MAYFLY_MAIN_THREAD;
+
+    reaver::plugin_registry first_registry;
+    reaver::plugin_registry second_registry;
+    auto first = first_registry.open("z");
+    auto second = second_registry.open("z");
+
+    reaver::hot_plugin_function<checksum> adler32{ first, "adler32" };
+
+    std::atomic<bool> done{ false };
+    std::atomic<std::size_t> wrong{ 0 };
+
+    std::vector<std::thread> callers;
+    for (auto i = 0; i < 3; ++i)
+    {
+        callers.emplace_back([&] {
+            MAYFLY_THREAD;
+
+            while (!done)
+            {
+                if (adler32(1, abc, 3) != adler32_abc)
+                {
+                    ++wrong;
+                }
+            }
+        });
+    }
+
+    for (auto i = 0; i < 100; ++i)
+    {
+        adler32.reload(i % 2 ? first : second);
+    }
+
+    done = true;
+    for (auto && caller : callers)
+    {
+        caller.join();
+    }
+
+    MAYFLY_CHECK(wrong == 0);
+    MAYFLY_CHECK(adler32.library() == first);
+
+    // reload() waits for the calls into the old library, so nothing else holds it anymore
+    MAYFLY_CHECK(second.use_count() == 1);
+});
+
+MAYFLY_END_SUITE;
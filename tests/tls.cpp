@@ -22,7 +22,15 @@
 
 #include <reaver/mayfly.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace test
 {
@@ -56,4 +64,150 @@ MAYFLY_ADD_TESTCASE("tls in multiple threads", []() {
     t2.join();
 });
 
+MAYFLY_ADD_TESTCASE("tls initial value in every thread", []() {
+    MAYFLY_MAIN_THREAD;
+
+    test::reaver::tls_variable<std::string> v{ "initial" };
+    v = "changed";
+
+    std::thread t{ [&]() {
+        MAYFLY_THREAD;
+        MAYFLY_CHECK(static_cast<std::string>(v) == "initial");
+    } };
+    t.join();
+
+    MAYFLY_CHECK(static_cast<std::string>(v) == "changed");
+});
+
+MAYFLY_ADD_TESTCASE("per thread objects", []() {
+    MAYFLY_MAIN_THREAD;
+
+    std::atomic<int> constructed{ 0 };
+    std::atomic<int> destroyed{ 0 };
+
+    struct counter
+    {
+        counter(std::atomic<int> & c, std::atomic<int> & d) : destroyed{ d }
+        {
+            ++c;
+        }
+
+        ~counter()
+        {
+            ++destroyed;
+        }
+
+        std::atomic<int> & destroyed;
+        std::atomic<std::size_t> value{ 0 };
+    };
+
+    {
+        test::reaver::per_thread<counter> counters{ [&]() -> counter { return { constructed, destroyed }; } };
+        MAYFLY_CHECK(constructed == 0);
+
+        auto f = [&](std::size_t n) {
+            MAYFLY_THREAD;
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                counters->value.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        std::thread t1{ f, 100 };
+        std::thread t2{ f, 200 };
+        t1.join();
+        t2.join();
+
+        MAYFLY_CHECK(constructed == 2);
+        MAYFLY_CHECK(destroyed == 2);
+
+        f(300);
+        f(1);
+
+        std::size_t sum = 0;
+        std::size_t instances = 0;
+        counters.for_each([&](const counter & c) {
+            sum += c.value;
+            ++instances;
+        });
+
+        MAYFLY_CHECK(instances == 1);
+        MAYFLY_CHECK(sum == 301);
+    }
+
+    MAYFLY_CHECK(constructed == 3);
+    MAYFLY_CHECK(destroyed == 3);
+});
+
+MAYFLY_ADD_TESTCASE("per thread exit hook", []() {
+    MAYFLY_MAIN_THREAD;
+
+    std::size_t exited = 0;
+    std::size_t hooks = 0;
+    std::atomic<bool> destroyed{ false };
+    bool destroyed_before_hook = false;
+
+    struct tracked
+    {
+        tracked(std::atomic<bool> & d) : destroyed{ &d }
+        {
+        }
+
+        tracked(tracked && other) : destroyed{ std::exchange(other.destroyed, nullptr) }, value{ other.value }
+        {
+        }
+
+        ~tracked()
+        {
+            if (destroyed)
+            {
+                *destroyed = true;
+            }
+        }
+
+        std::atomic<bool> * destroyed;
+        std::size_t value = 0;
+    };
+
+    {
+        test::reaver::per_thread<tracked> values{ [&] { return tracked{ destroyed }; },
+            [&](tracked & t) {
+                // runs on the exiting thread, before the instance goes away
+                destroyed_before_hook = destroyed_before_hook || destroyed;
+                exited += t.value;
+                ++hooks;
+            } };
+
+        auto f = [&](std::size_t n) {
+            MAYFLY_THREAD;
+            values->value += n;
+        };
+
+        std::thread t1{ f, 100 };
+        t1.join();
+        MAYFLY_CHECK(hooks == 1);
+        MAYFLY_CHECK(exited == 100);
+        MAYFLY_CHECK(destroyed);
+
+        destroyed = false;
+        std::thread t2{ f, 200 };
+        t2.join();
+        MAYFLY_CHECK(hooks == 2);
+        MAYFLY_CHECK(exited == 300);
+
+        // threads that never used it don't call it
+        std::thread t3{ [] {} };
+        t3.join();
+        MAYFLY_CHECK(hooks == 2);
+
+        f(1);
+    }
+
+    // the main thread's instance is destroyed with the per_thread, without the hook
+    MAYFLY_CHECK(hooks == 2);
+    MAYFLY_CHECK(exited == 300);
+    MAYFLY_CHECK(!destroyed_before_hook);
+});
+
 MAYFLY_END_SUITE;
@@ -22,6 +22,10 @@
 
 #include <reaver/mayfly.h>
 
+#include <random>
+#include <string>
+#include <vector>
+
 #include "wildcard.h"
 
 MAYFLY_BEGIN_SUITE("wildcard");
@@ -52,4 +56,97 @@ MAYFLY_ADD_TESTCASE("star and question mark", [] {
     MAYFLY_REQUIRE(reaver::wildcard::match("fo?*?ar", "foo bar"));
 });
 
+MAYFLY_ADD_TESTCASE("compiled pattern", [] {
+    reaver::wildcard::compiled_pattern pattern{ "foo*.c?p" };
+
+    MAYFLY_REQUIRE(pattern.matches("foo.cpp"));
+    MAYFLY_REQUIRE(pattern.matches("foobar.chp"));
+    MAYFLY_REQUIRE(!pattern.matches("foo.cp"));
+    MAYFLY_REQUIRE(!pattern.matches("fo.cpp"));
+    MAYFLY_REQUIRE(!pattern.is_literal());
+
+    MAYFLY_REQUIRE(reaver::wildcard::compiled_pattern{ "foo.cpp" }.is_literal());
+    MAYFLY_REQUIRE(reaver::wildcard::compiled_pattern{ "foo.cpp" }.matches("foo.cpp"));
+    MAYFLY_REQUIRE(!reaver::wildcard::compiled_pattern{ "foo.cpp" }.matches("foo.cppx"));
+});
+
+MAYFLY_ADD_TESTCASE("empty and repeated stars", [] {
+    MAYFLY_REQUIRE(reaver::wildcard::match("*", ""));
+    MAYFLY_REQUIRE(reaver::wildcard::match("", ""));
+    MAYFLY_REQUIRE(reaver::wildcard::match("a**", "a"));
+    MAYFLY_REQUIRE(reaver::wildcard::match("a**b", "ab"));
+    MAYFLY_REQUIRE(reaver::wildcard::match("*ab*ba*", "xabba"));
+
+    MAYFLY_REQUIRE(!reaver::wildcard::match("?", ""));
+    MAYFLY_REQUIRE(!reaver::wildcard::match("*ab*ba*", "aba"));
+    MAYFLY_REQUIRE(!reaver::wildcard::match("ab*ba", "aba"));
+});
+
+MAYFLY_ADD_TESTCASE("many stars", [] {
+    std::string string(10000, 'a');
+    MAYFLY_REQUIRE(!reaver::wildcard::match("*a*a*a*a*a*a*a*a*a*a*a*a*b", string));
+    MAYFLY_REQUIRE(reaver::wildcard::match("*a*a*a*a*a*a*a*a*a*a*a*a*", string));
+});
+
+// match() walks the pattern itself instead of compiling it; both have to agree on everything
+MAYFLY_ADD_TESTCASE("match agrees with compiled pattern", [] {
+    std::minstd_rand random{ 42 };
+    auto generate = [&](const char * alphabet, std::size_t alphabet_size) {
+        std::string ret(random() % 8, ' ');
+        for (auto & c : ret)
+        {
+            c = alphabet[random() % alphabet_size];
+        }
+        return ret;
+    };
+
+    for (auto i = 0; i < 10000; ++i)
+    {
+        auto pattern = generate("ab*?", 4);
+        auto string = generate("ab", 2);
+        MAYFLY_REQUIRE(reaver::wildcard::match(pattern, string) == reaver::wildcard::compiled_pattern{ pattern }.matches(string));
+    }
+
+    MAYFLY_REQUIRE(reaver::wildcard::match("xx*.cpp", "yyy.cpp", 2, 3));
+    MAYFLY_REQUIRE(!reaver::wildcard::match("xx*.cpp", "yyy.cpp", 2, 4));
+});
+
+MAYFLY_ADD_TESTCASE("pattern set", [] {
+    reaver::wildcard::pattern_set set{ "*.cpp", "*.h", "foo*", "*o?.c*", "*", "test_*.cpp", "??", "bar" };
+
+    MAYFLY_REQUIRE(set.size() == 8);
+    MAYFLY_REQUIRE(set.matches("foo.cpp") == (std::vector<std::size_t>{ 0, 2, 3, 4 }));
+    MAYFLY_REQUIRE(set.matches("test_x.cpp") == (std::vector<std::size_t>{ 0, 4, 5 }));
+    MAYFLY_REQUIRE(set.matches("ab") == (std::vector<std::size_t>{ 4, 6 }));
+    MAYFLY_REQUIRE(set.matches("bar") == (std::vector<std::size_t>{ 4, 7 }));
+    MAYFLY_REQUIRE(set.matches("x.hpp") == (std::vector<std::size_t>{ 4 }));
+
+    reaver::wildcard::pattern_set sources{ "*.cpp", "*.h" };
+    MAYFLY_REQUIRE(sources.matches_any("a.cpp"));
+    MAYFLY_REQUIRE(sources.matches_any("b.h"));
+    MAYFLY_REQUIRE(!sources.matches_any("c.hpp"));
+    MAYFLY_REQUIRE(sources.matches("c.hpp").empty());
+});
+
+// literals made of every byte that isn't a wildcard; all of them need classes of their own
+MAYFLY_ADD_TESTCASE("pattern set of all bytes", [] {
+    std::vector<std::string> patterns;
+    for (auto c = 0; c < 256; ++c)
+    {
+        if (c != '*' && c != '?')
+        {
+            patterns.push_back("*" + std::string(1, static_cast<char>(c)) + std::string(1, static_cast<char>(c)) + "*");
+        }
+    }
+
+    reaver::wildcard::pattern_set set{ patterns };
+    MAYFLY_REQUIRE(set.size() == 254);
+
+    for (std::size_t i = 0; i < patterns.size(); ++i)
+    {
+        auto name = "x" + patterns[i].substr(1, 2) + "x";
+        MAYFLY_REQUIRE(set.matches(name) == (std::vector<std::size_t>{ i }));
+    }
+});
+
 MAYFLY_END_SUITE;